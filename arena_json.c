@@ -0,0 +1,110 @@
+/**
+ * @file arena_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the arena allocator
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "arena_json.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+enum
+{
+	ARENA_ALIGN = _Alignof(max_align_t),		 ///<\brief the alignment of the allocations
+	ARENA_MIN_BLOCK = 1 << 16,					 ///<\brief the size of the first block
+	ARENA_HEADER = (sizeof(json_arena_block) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1) ///<\brief the aligned size of the block header
+};
+
+/**
+ * @brief Get the usable memory of an arena block
+ *
+ * @param block The arena block
+ * @return Pointer to the first usable byte
+ */
+static char *block_data(json_arena_block *block)
+{
+	return (char *)block + ARENA_HEADER;
+}
+
+void json_arena_init(json_arena *arena)
+{
+	arena->first = NULL;
+	arena->current = NULL;
+}
+
+void *json_arena_alloc(json_arena *arena, size_t size)
+{
+	if (size > SIZE_MAX - (ARENA_ALIGN - 1))
+		return NULL;
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	json_arena_block *block = arena->current;
+	if (block != NULL && block->size - block->used >= size)
+	{
+		void *p = block_data(block) + block->used;
+		block->used += size;
+		return p;
+	}
+
+	// the blocks after the current one are kept by a reset, the first one large enough is taken
+	json_arena_block *prev = block;
+	json_arena_block *nb = block != NULL ? block->next : NULL;
+	while (nb != NULL && nb->size < size)
+	{
+		prev = nb;
+		nb = nb->next;
+	}
+	if (nb != NULL)
+		prev->next = nb->next;
+	else
+	{
+		// a new block at least twice as large as the current one
+		size_t bsize = block == NULL ? ARENA_MIN_BLOCK : 2 * block->size;
+		if (bsize < size)
+			bsize = size;
+		if (bsize > SIZE_MAX - ARENA_HEADER)
+			return NULL;
+		nb = malloc(ARENA_HEADER + bsize);
+		if (nb == NULL)
+			return NULL;
+		nb->size = bsize;
+	}
+
+	// the block follows the current one, the skipped smaller blocks stay kept after it
+	if (block == NULL)
+	{
+		nb->next = NULL;
+		arena->first = nb;
+	}
+	else
+	{
+		nb->next = block->next;
+		block->next = nb;
+	}
+	nb->used = size;
+	arena->current = nb;
+	return block_data(nb);
+}
+
+void json_arena_reset(json_arena *arena)
+{
+	arena->current = arena->first;
+	if (arena->first != NULL)
+		arena->first->used = 0;
+}
+
+void json_arena_free(json_arena *arena)
+{
+	json_arena_block *block = arena->first;
+	while (block != NULL)
+	{
+		json_arena_block *next = block->next;
+		free(block);
+		block = next;
+	}
+	json_arena_init(arena);
+}
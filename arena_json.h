@@ -0,0 +1,73 @@
+/**
+ * @file arena_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief bump pointer arena allocator of the JSON library
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef ARENA_JSON_H_INCLUDED
+#define ARENA_JSON_H_INCLUDED
+
+#include <stddef.h>
+
+/**
+ * @brief memory block of an arena
+ */
+typedef struct json_arena_block
+{
+	struct json_arena_block *next; ///<\brief the next block or NULL at list end
+	size_t size;				   ///<\brief the number of usable bytes in the block
+	size_t used;				   ///<\brief the number of allocated bytes in the block
+} json_arena_block;
+
+/**
+ * @brief bump pointer arena
+ *
+ * The arena allocates from a list of growing memory blocks by incrementing a pointer.
+ * The allocations are released all at once by resetting or freeing the arena.
+ */
+typedef struct
+{
+	json_arena_block *first;   ///<\brief the first block or NULL if no block is allocated
+	json_arena_block *current; ///<\brief the block the allocations are served from
+} json_arena;
+
+/**
+ * @brief Initialize an empty arena
+ *
+ * @param arena The arena
+ */
+void json_arena_init(json_arena *arena);
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * The memory is aligned for any object type.
+ *
+ * @param arena The arena
+ * @param size The number of bytes
+ * @return Pointer to the allocated memory or NULL if could not allocate
+ */
+void *json_arena_alloc(json_arena *arena, size_t size);
+
+/**
+ * @brief Release all allocations of an arena
+ *
+ * The blocks are kept and reused by the subsequent allocations.
+ *
+ * @param arena The arena
+ */
+void json_arena_reset(json_arena *arena);
+
+/**
+ * @brief Release the blocks of an arena
+ *
+ * @param arena The arena
+ */
+void json_arena_free(json_arena *arena);
+
+#endif // ARENA_JSON_H_INCLUDED
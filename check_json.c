@@ -0,0 +1,2069 @@
+/**
+ * @file check_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief consistency check of the parsers
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ * Each input file is read by every parser of the library and the printed trees
+ * are compared with the tree parsed from the token list. Malformed inputs
+ * must be rejected by every parser.
+ */
+#include "arena_json.h"
+#include "ndjson_json.h"
+#include "ondemand_json.h"
+#include "parse_json.h"
+#include "sax_json.h"
+#include "tape_json.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum
+{
+	NDJSON_MIN_SIZE = 5 << 19, ///<\brief the minimal size of the generated NDJSON file, it spans several chunks
+	MAX_CHUNK = 64,			   ///<\brief the maximal chunk size fed to the push parser
+	STREAM_WINDOW = 64 * 1024, ///<\brief the initial window of the stream lexer
+	STREAM_SIZE = 4 << 20	   ///<\brief the size of the generated stream with an early error
+};
+
+/**
+ * @brief printed tree
+ */
+typedef struct
+{
+	char *str;	///<\brief the printed characters
+	size_t len; ///<\brief the number of printed characters
+	FILE *fout; ///<\brief the stream writing the characters
+	int error;	///<\brief nonzero if the parser failed
+} check_output;
+
+/**
+ * @brief Inputs rejected by every parser
+ */
+static char const *const malformed[] = {
+	"",
+	"   ",
+	"[",
+	"]",
+	"{",
+	"[1",
+	"[1,",
+	"[1,]",
+	"[,1]",
+	"[1 2]",
+	"[1,,2]",
+	"[}",
+	"{]",
+	"[[1]",
+	"[1]]",
+	"{\"a\"}",
+	"{\"a\":}",
+	"{\"a\" 1}",
+	"{\"a\":1,}",
+	"{\"a\":1 \"b\":2}",
+	"{1:2}",
+	"{\"a\":1:2}",
+	"[\"unterminated]",
+	"[\"\\x\"]",
+	"{\"\\u12\":1}",
+	"[tru]",
+	"[nul]",
+	"[@]",
+	"[1.]",
+	"[.5]",
+	"[-]",
+	"[+1]",
+	"[01]",
+	"[1e]",
+	"[1e+]",
+	"[0x10]",
+	"[1.5.2]",
+	"1",
+	"\"string\"",
+	"true",
+};
+
+/**
+ * @brief The structural indexing kernels, the ones not supported by the processor are skipped
+ */
+static char const *const kernels[] = {"swar", "sse4.2", "avx2", "avx512"};
+
+/**
+ * @brief Start printing into memory
+ *
+ * @param out The output
+ * @return The stream to print to or NULL if could not allocate
+ */
+static FILE *output_open(check_output *out)
+{
+	out->str = NULL;
+	out->len = 0;
+	out->error = 0;
+	out->fout = open_memstream(&out->str, &out->len);
+	return out->fout;
+}
+
+/**
+ * @brief Finish printing and compare the output with the expected one
+ *
+ * @param out The output, its characters are released
+ * @param expected The expected output
+ * @param path The checked file
+ * @param what The name of the checked parser
+ * @return 0 if the outputs are the same, 1 if not
+ */
+static int output_check(check_output *out, check_output const *expected, char const *path, char const *what)
+{
+	if (out->fout != NULL)
+		fclose(out->fout);
+	int same = out->fout != NULL && !out->error && out->len == expected->len &&
+			   memcmp(out->str, expected->str, out->len) == 0;
+	if (!same)
+		fprintf(stderr, "%s: %s differs\n", path, what);
+	free(out->str);
+	return !same;
+}
+
+/**
+ * @brief Print a tree into memory and compare it with the expected output
+ *
+ * @param tree The tree
+ * @param expected The expected output
+ * @param path The checked file
+ * @param what The name of the checked parser
+ * @return 0 if the tree is printed as expected, 1 if not
+ */
+static int check_tree(syntax_tree tree, check_output const *expected, char const *path, char const *what)
+{
+	check_output out;
+	if (output_open(&out) != NULL && tree != NULL)
+		syntax_tree_print(tree, out.fout);
+	out.error = tree == NULL;
+	return output_check(&out, expected, path, what);
+}
+
+/**
+ * @brief Report a malformed input accepted by a parser
+ *
+ * @param input The malformed input
+ * @param what The name of the checked parser
+ * @return 1
+ */
+static int accepted(char const *input, char const *what)
+{
+	fprintf(stderr, "malformed input: %s accepts \"%s\"\n", what, input);
+	return 1;
+}
+
+/**
+ * @brief Parse a buffer through the token list
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param[out] trailing Nonzero if tokens follow the root
+ * @return The tree or NULL if could not parse
+ */
+static syntax_tree list_parse(char const *buf, size_t len, int *trailing)
+{
+	token_list tl = token_list_read_from_buffer(buf, len);
+	token_list end = NULL;
+	syntax_tree tree = tl != NULL ? parse_json(tl, &end) : NULL;
+	*trailing = end != NULL;
+	token_list_delete(tl);
+	return tree;
+}
+
+/**
+ * @brief Convert the lazy numbers of a tree through the number accessors
+ *
+ * @param tree The syntax tree
+ */
+static void materialize_numbers(syntax_tree tree)
+{
+	double d;
+	if (tree == NULL)
+		return;
+	if (tree->type == syntax_number)
+		syntax_tree_get_double(tree, &d);
+	for (syntax_tree *c = syntax_tree_first_child(tree); c != NULL; c = syntax_tree_next_sibling(c))
+		materialize_numbers(*c);
+}
+
+/**
+ * @brief Check the token tape parser with every indexing kernel and with lazy numbers
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_tokens(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	int failed = 0;
+	char const *selected = structural_index_kernel_name();
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+	{
+		if (structural_index_set_kernel(kernels[i]) != 0)
+			continue;
+		for (int lazy = 0; lazy < 2; lazy++)
+		{
+			token_tape *tape = token_tape_read_from_buffer(buf, len, LEX_ZERO_COPY | (lazy ? LEX_LAZY_NUMBERS : 0));
+			size_t e = 0;
+			syntax_tree tree = tape != NULL ? parse_json_tape(tape, &e) : NULL;
+			if (lazy)
+				materialize_numbers(tree);
+			failed += check_tree(tree, expected, path, kernels[i]);
+			if (tree != NULL && e != tape->size)
+			{
+				fprintf(stderr, "%s: parse_json_tape stops at token %zu of %zu\n", path, e, tape->size);
+				failed++;
+			}
+			syntax_tree_delete(tree);
+			token_tape_delete(tape);
+		}
+	}
+	structural_index_set_kernel(selected);
+	return failed;
+}
+
+/**
+ * @brief Check the document parser with and without the value dictionary
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_document(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	json_document *doc = json_document_create();
+	if (doc == NULL)
+		return 1;
+	int failed = 0;
+	// the second parse reuses the storage of the first one
+	for (int i = 0; i < 2; i++)
+		failed += check_tree(json_document_parse_buffer(doc, buf, len, LEX_ZERO_COPY), expected, path, "json_document");
+	syntax_tree tree = json_document_parse_buffer(doc, buf, len, LEX_LAZY_NUMBERS);
+	materialize_numbers(tree);
+	failed += check_tree(tree, expected, path, "json_document lazy");
+	// a truncated input releases the previous tree, the next parse starts over
+	if (len > 1 && json_document_parse_buffer(doc, buf, len / 2, 0) != NULL)
+	{
+		fprintf(stderr, "%s: json_document accepts the first half\n", path);
+		failed++;
+	}
+	failed += check_tree(json_document_parse_buffer(doc, buf, len, 0), expected, path, "json_document");
+	json_document_set_dictionary(doc, 1);
+	failed += check_tree(json_document_parse_buffer(doc, buf, len, 0), expected, path, "json_document dictionary");
+	json_document_delete(doc);
+	return failed;
+}
+
+/**
+ * @brief Check if only whitespace follows a position of a buffer
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param pos The position
+ * @return Nonzero if only whitespace follows
+ */
+static int only_whitespace(char const *buf, size_t len, size_t pos)
+{
+	while (pos < len && (buf[pos] == ' ' || buf[pos] == '\t' || buf[pos] == '\r' || buf[pos] == '\n'))
+		pos++;
+	return pos == len;
+}
+
+/**
+ * @brief Check the single pass parser and the tokens of the pull lexer
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_pull(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	static unsigned const flags[] = {0, LEX_ZERO_COPY, LEX_ZERO_COPY | LEX_LAZY_NUMBERS};
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+	{
+		size_t end = 0;
+		syntax_tree tree = parse_json_from_buffer(buf, len, flags[i], &end);
+		materialize_numbers(tree);
+		failed += check_tree(tree, expected, path, "parse_json_from_buffer");
+		if (tree != NULL && !only_whitespace(buf, len, end))
+		{
+			fprintf(stderr, "%s: parse_json_from_buffer stops at character %zu of %zu\n", path, end, len);
+			failed++;
+		}
+		syntax_tree_delete(tree);
+	}
+
+	token_tape *tape = token_tape_read_from_buffer(buf, len, LEX_ZERO_COPY);
+	json_lexer lexer;
+	json_lexer_init(&lexer, buf, len, LEX_ZERO_COPY);
+	token_t tok;
+	size_t n = 0;
+	int same = tape != NULL;
+	for (int r; same && (r = json_lexer_next(&lexer, &tok)) != 0; n++)
+	{
+		token_t const *expected_tok = token_tape_get(tape, n);
+		same = r == 1 && expected_tok != NULL && tok.type == expected_tok->type;
+		if (same && tok.type == TOKEN_STRING)
+			same = tok.value.string.len == expected_tok->value.string.len &&
+				   memcmp(tok.value.string.ptr, expected_tok->value.string.ptr, tok.value.string.len) == 0;
+		if (r == 1)
+			token_free(&tok);
+	}
+	if (!same || n != tape->size)
+	{
+		fprintf(stderr, "%s: json_lexer tokens differ\n", path);
+		failed++;
+	}
+	token_tape_delete(tape);
+	return failed;
+}
+
+/**
+ * @brief Print the indentation of a node
+ *
+ * @param fout Output stream
+ * @param depth The indentation depth
+ */
+static void print_indent(FILE *fout, int depth)
+{
+	for (int i = 0; i < depth; i++)
+		fputc('\t', fout);
+}
+
+/**
+ * @brief Print a scalar token in the format of the syntax tree printer
+ *
+ * @param fout Output stream
+ * @param depth The indentation depth
+ * @param tok The scalar token
+ */
+static void print_scalar(FILE *fout, int depth, token_t const *tok)
+{
+	print_indent(fout, depth);
+	switch (tok->type)
+	{
+	case TOKEN_STRING:
+		fprintf(fout, "STRING:  %.*s", (int)tok->value.string.len, tok->value.string.ptr);
+		break;
+	case TOKEN_NUMBER:
+		fprintf(fout, "NUMBER:  %f", tok->value.number);
+		break;
+	case TOKEN_INTEGER:
+		fprintf(fout, "INTEGER:  %" PRId64, tok->value.integer);
+		break;
+	case TOKEN_UNSIGNED:
+		fprintf(fout, "INTEGER:  %" PRIu64, tok->value.uinteger);
+		break;
+	case TOKEN_TRUE:
+		fprintf(fout, "TRUE");
+		break;
+	case TOKEN_FALSE:
+		fprintf(fout, "FALSE");
+		break;
+	default:
+		fprintf(fout, "NULL");
+		break;
+	}
+	fputc('\n', fout);
+}
+
+/**
+ * @brief Print an on demand value and its children
+ *
+ * The number getters are checked against the number token at the position of the value.
+ *
+ * @param value The value
+ * @param fout Output stream
+ * @param depth The indentation depth
+ * @return 0 on success, -1 if the value could not be read
+ */
+static int ondemand_print(json_ondemand_value const *value, FILE *fout, int depth)
+{
+	json_ondemand_doc const *doc = value->doc;
+	json_ondemand_iter it;
+	json_ondemand_value key, child;
+	json_lexer lexer;
+	token_t tok;
+	int ret;
+	switch (json_ondemand_type(value))
+	{
+	case TOKEN_BRACKET_OBJECT_OPEN:
+	case TOKEN_BRACKET_ARRAY_OPEN:
+		if (json_ondemand_iter_init(value, &it) != 0)
+			return -1;
+		print_indent(fout, depth);
+		fprintf(fout, it.object ? "OBJECT: \n" : "ARRAY: \n");
+		while ((ret = json_ondemand_iter_next(&it, &key, &child)) == 1)
+		{
+			if (it.object)
+			{
+				print_indent(fout, depth + 1);
+				fprintf(fout, "PAIR: \n");
+				if (json_ondemand_get_string(&key, &tok) != 0)
+					return -1;
+				print_scalar(fout, depth + 2, &tok);
+				token_free(&tok);
+			}
+			if (ondemand_print(&child, fout, it.object ? depth + 2 : depth + 1) != 0)
+				return -1;
+		}
+		return ret;
+	case TOKEN_STRING:
+		if (json_ondemand_get_string(value, &tok) != 0)
+			return -1;
+		break;
+	case TOKEN_TRUE:
+	case TOKEN_FALSE:
+		if (json_ondemand_get_bool(value, &ret) != 0)
+			return -1;
+		tok.type = ret ? TOKEN_TRUE : TOKEN_FALSE;
+		break;
+	case TOKEN_NULL:
+		if (!json_ondemand_is_null(value))
+			return -1;
+		tok.type = TOKEN_NULL;
+		break;
+	default:
+		json_lexer_init(&lexer, doc->buf + doc->index.positions[value->pos], doc->len - doc->index.positions[value->pos], 0);
+		if (json_lexer_next(&lexer, &tok) != 1)
+			return -1;
+		if (tok.type != TOKEN_NUMBER && tok.type != TOKEN_INTEGER && tok.type != TOKEN_UNSIGNED)
+		{
+			token_free(&tok);
+			return -1;
+		}
+		int64_t i;
+		uint64_t u;
+		double d;
+		if (tok.type == TOKEN_INTEGER && (json_ondemand_get_int64(value, &i) != 0 || i != tok.value.integer))
+			return -1;
+		if (tok.type == TOKEN_UNSIGNED && (json_ondemand_get_uint64(value, &u) != 0 || u != tok.value.uinteger))
+			return -1;
+		if (tok.type == TOKEN_NUMBER && (json_ondemand_get_double(value, &d) != 0 || d != tok.value.number))
+			return -1;
+		break;
+	}
+	print_scalar(fout, depth, &tok);
+	if (tok.type == TOKEN_STRING)
+		token_free(&tok);
+	return 0;
+}
+
+/**
+ * @brief Check the on demand navigation
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_ondemand(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	int failed = 0;
+	json_ondemand_doc doc;
+	json_ondemand_init(&doc);
+	// the second parse reuses the index of the first one
+	for (unsigned flags = 0; flags <= LEX_ZERO_COPY; flags += LEX_ZERO_COPY)
+	{
+		check_output out;
+		if (output_open(&out) != NULL)
+		{
+			json_ondemand_value root;
+			json_ondemand_root(&doc, &root);
+			out.error = json_ondemand_parse(&doc, buf, len, flags) != 0 || ondemand_print(&root, out.fout, 0) != 0;
+		}
+		failed += output_check(&out, expected, path, "json_ondemand");
+	}
+	json_ondemand_free(&doc);
+	return failed;
+}
+
+/**
+ * @brief state of the event printer
+ */
+typedef struct
+{
+	FILE *fout;							  ///<\brief output stream
+	size_t depth;						  ///<\brief the number of open containers
+	int object[JSON_SAX_MAX_DEPTH];		  ///<\brief nonzero for the open objects
+	int indent[JSON_SAX_MAX_DEPTH];		  ///<\brief the indentation depth of the open containers
+} sax_printer;
+
+/**
+ * @brief Get the indentation depth of the next value
+ *
+ * @param p The event printer
+ * @return The indentation depth
+ */
+static int sax_indent(sax_printer const *p)
+{
+	if (p->depth == 0)
+		return 0;
+	return p->indent[p->depth - 1] + (p->object[p->depth - 1] ? 2 : 1);
+}
+
+/**
+ * @brief Print an opened container
+ *
+ * @param p The event printer
+ * @param object Nonzero for an object
+ * @return 0 to continue
+ */
+static int sax_open(sax_printer *p, int object)
+{
+	int indent = sax_indent(p);
+	print_indent(p->fout, indent);
+	fprintf(p->fout, object ? "OBJECT: \n" : "ARRAY: \n");
+	p->object[p->depth] = object;
+	p->indent[p->depth++] = indent;
+	return 0;
+}
+
+/**
+ * @brief Print a scalar event
+ *
+ * @param p The event printer
+ * @param tok The scalar token
+ * @return 0 to continue
+ */
+static int sax_scalar(sax_printer *p, token_t const *tok)
+{
+	print_scalar(p->fout, sax_indent(p), tok);
+	return 0;
+}
+
+static int sax_start_object(void *ctx)
+{
+	return sax_open(ctx, 1);
+}
+
+static int sax_start_array(void *ctx)
+{
+	return sax_open(ctx, 0);
+}
+
+static int sax_end(void *ctx)
+{
+	((sax_printer *)ctx)->depth--;
+	return 0;
+}
+
+static int sax_key(void *ctx, json_string key)
+{
+	sax_printer *p = ctx;
+	print_indent(p->fout, p->indent[p->depth - 1] + 1);
+	fprintf(p->fout, "PAIR: \n");
+	token_t tok = {TOKEN_STRING, 0, {.string = key}, 0};
+	return sax_scalar(p, &tok);
+}
+
+static int sax_string(void *ctx, json_string value)
+{
+	token_t tok = {TOKEN_STRING, 0, {.string = value}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+static int sax_number(void *ctx, double value)
+{
+	token_t tok = {TOKEN_NUMBER, 0, {.number = value}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+static int sax_integer(void *ctx, int64_t value)
+{
+	token_t tok = {TOKEN_INTEGER, 0, {.integer = value}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+static int sax_uinteger(void *ctx, uint64_t value)
+{
+	token_t tok = {TOKEN_UNSIGNED, 0, {.uinteger = value}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+static int sax_boolean(void *ctx, int value)
+{
+	token_t tok = {value ? TOKEN_TRUE : TOKEN_FALSE, 0, {.integer = 0}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+static int sax_null(void *ctx)
+{
+	token_t tok = {TOKEN_NULL, 0, {.integer = 0}, 0};
+	return sax_scalar(ctx, &tok);
+}
+
+/**
+ * @brief Check the event parser
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_sax(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	json_sax_handler const h = {sax_start_object, sax_end, sax_start_array, sax_end, sax_key, sax_string,
+								sax_number, sax_integer, sax_uinteger, sax_boolean, sax_null};
+	check_output out;
+	sax_printer *p = malloc(sizeof(sax_printer));
+	if (output_open(&out) != NULL)
+	{
+		out.error = p == NULL;
+		if (p != NULL)
+		{
+			p->fout = out.fout;
+			p->depth = 0;
+			out.error = json_sax_parse(buf, len, &h, p) != 0;
+		}
+	}
+	free(p);
+	return output_check(&out, expected, path, "json_sax");
+}
+
+/**
+ * @brief Check if two tokens are the same
+ *
+ * @param a The first token
+ * @param b The second token
+ * @return Nonzero if the tokens are the same
+ */
+static int same_token(token_t const *a, token_t const *b)
+{
+	if (a->type != b->type || a->line_cntr != b->line_cntr)
+		return 0;
+	switch (a->type)
+	{
+	case TOKEN_STRING:
+		return a->value.string.len == b->value.string.len &&
+			   memcmp(a->value.string.ptr, b->value.string.ptr, a->value.string.len) == 0;
+	case TOKEN_NUMBER:
+		return a->value.number == b->value.number;
+	case TOKEN_INTEGER:
+	case TOKEN_UNSIGNED:
+		return a->value.uinteger == b->value.uinteger;
+	default:
+		return 1;
+	}
+}
+
+/**
+ * @brief Check the stream lexer against the buffer lexer
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param fin The stream of the same characters
+ * @param path The name of the checked input
+ * @return 0 if the tokens are the same, 1 if not
+ */
+static int compare_lexers(char const *buf, size_t len, FILE *fin, char const *path)
+{
+	json_lexer file;
+	if (fin == NULL || json_lexer_init_file(&file, fin, 0) != 0)
+	{
+		fprintf(stderr, "%s: could not open the stream lexer\n", path);
+		return 1;
+	}
+	json_lexer lexer;
+	json_lexer_init(&lexer, buf, len, 0);
+	token_t a, b;
+	int ra, rb;
+	int same = 1;
+	do
+	{
+		ra = json_lexer_next(&lexer, &a);
+		rb = json_lexer_next(&file, &b);
+		same = ra == rb && (ra != 1 || same_token(&a, &b));
+		if (ra == 1)
+			token_free(&a);
+		if (rb == 1)
+			token_free(&b);
+	} while (same && ra == 1);
+	json_lexer_free(&file);
+	if (!same)
+		fprintf(stderr, "%s: json_lexer stream differs\n", path);
+	return !same;
+}
+
+/**
+ * @brief Check the stream lexer on a file
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_lexer(char const *buf, size_t len, char const *path)
+{
+	FILE *fin = fopen(path, "rb");
+	int failed = compare_lexers(buf, len, fin, path);
+	if (fin != NULL)
+		fclose(fin);
+	return failed;
+}
+
+/**
+ * @brief Check the stream lexer on tokens around the window boundaries and on a token longer than the window
+ *
+ * @return The number of failed checks
+ */
+static int check_stream(void)
+{
+	size_t const size = 300000;
+	char *buf = malloc(size);
+	if (buf == NULL)
+		return 1;
+	size_t len = 0;
+	buf[len++] = '[';
+	// a long string grows the window
+	buf[len++] = '"';
+	memset(buf + len, 'a', 100000);
+	len += 100000;
+	len += (size_t)sprintf(buf + len, "\\u00e9\"");
+	while (len < size - 64)
+		len += (size_t)sprintf(buf + len, ",%d.5e-3,\"\\n%zu\",true,null,-%zu\n", (int)(len % 1000), len, len);
+	buf[len++] = ']';
+	FILE *fin = fmemopen(buf, len, "rb");
+	int failed = compare_lexers(buf, len, fin, "stream");
+	if (fin != NULL)
+		fclose(fin);
+
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		// fmemopen of an empty buffer fails
+		size_t n = strlen(malformed[i]);
+		if (n == 0)
+			continue;
+		fin = fmemopen((void *)malformed[i], n, "rb");
+		failed += compare_lexers(malformed[i], n, fin, malformed[i]);
+		if (fin != NULL)
+			fclose(fin);
+	}
+	free(buf);
+	return failed;
+}
+
+/**
+ * @brief Check that the stream lexer reads no further than the window that decides a token
+ *
+ * An early error of a large stream is reported without growing the window,
+ * a string ending at the window end is read without a refill, a number is read after one.
+ *
+ * @return The number of failed checks
+ */
+static int check_stream_window(void)
+{
+	char *buf = malloc(STREAM_SIZE);
+	if (buf == NULL)
+		return 1;
+	int failed = 0;
+	char const *const early[] = {"[1,tru,", "[1,@,", "[\"\\x\",", "[1e,"};
+	for (size_t i = 0; i < sizeof(early) / sizeof(early[0]); i++)
+	{
+		size_t len = strlen(early[i]);
+		memcpy(buf, early[i], len);
+		for (; len + 4 < STREAM_SIZE; len += 2)
+			memcpy(buf + len, "1,", 2);
+		memcpy(buf + len, "1]", 2);
+		len += 2;
+		FILE *fin = fmemopen(buf, len, "rb");
+		json_lexer lexer;
+		if (fin == NULL || json_lexer_init_file(&lexer, fin, 0) != 0)
+		{
+			fprintf(stderr, "%s: could not open the stream lexer\n", early[i]);
+			failed++;
+		}
+		else
+		{
+			token_t tok;
+			int r;
+			while ((r = json_lexer_next(&lexer, &tok)) == 1)
+				token_free(&tok);
+			long pos = ftell(fin);
+			if (r != -1 || lexer.capacity != STREAM_WINDOW || pos < 0 || pos > STREAM_WINDOW)
+			{
+				fprintf(stderr, "%s: json_lexer stream reads %ld characters to the early error\n", early[i], pos);
+				failed++;
+			}
+			json_lexer_free(&lexer);
+		}
+		if (fin != NULL)
+			fclose(fin);
+	}
+
+	// the string ends at the window end
+	size_t len = 0;
+	buf[len++] = '[';
+	buf[len++] = '"';
+	memset(buf + len, 'a', STREAM_WINDOW - 3);
+	len += STREAM_WINDOW - 3;
+	buf[len++] = '"';
+	len += (size_t)sprintf(buf + len, ",1]");
+	FILE *fin = fmemopen(buf, len, "rb");
+	json_lexer lexer;
+	if (fin == NULL || json_lexer_init_file(&lexer, fin, 0) != 0)
+		failed++;
+	else
+	{
+		token_t open, str;
+		int r = json_lexer_next(&lexer, &open);
+		if (r != 1 || json_lexer_next(&lexer, &str) != 1 || str.type != TOKEN_STRING || ftell(fin) != STREAM_WINDOW)
+		{
+			fprintf(stderr, "stream: the string at the window end is not read without a refill\n");
+			failed++;
+		}
+		else
+			token_free(&str);
+		json_lexer_free(&lexer);
+	}
+	if (fin != NULL)
+		fclose(fin);
+
+	// the number continues after the window end
+	len = 0;
+	buf[len++] = '[';
+	memset(buf + len, ' ', STREAM_WINDOW - 3);
+	len += STREAM_WINDOW - 3;
+	len += (size_t)sprintf(buf + len, "1234]");
+	fin = fmemopen(buf, len, "rb");
+	failed += compare_lexers(buf, len, fin, "stream window end");
+	if (fin != NULL)
+		fclose(fin);
+	free(buf);
+	return failed;
+}
+
+/**
+ * @brief Feed a buffer to the push parser in chunks
+ *
+ * @param stream The push parser
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param chunk The chunk size or 0 for random chunk sizes
+ * @return The parsed tree or NULL if could not parse
+ */
+static syntax_tree push_parse(json_stream *stream, char const *buf, size_t len, size_t chunk)
+{
+	if (stream == NULL)
+		return NULL;
+	for (size_t pos = 0; pos < len;)
+	{
+		size_t n = chunk != 0 ? chunk : 1 + (size_t)rand() % MAX_CHUNK;
+		if (n > len - pos)
+			n = len - pos;
+		if (json_stream_feed(stream, buf + pos, n) != 0)
+			return NULL;
+		pos += n;
+	}
+	return json_stream_finish(stream);
+}
+
+/**
+ * @brief Check the push parser with single characters, random chunks and the whole buffer
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_push(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	int failed = 0;
+	size_t chunks[] = {1, 0, len};
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		json_stream *stream = json_stream_create(NULL);
+		syntax_tree tree = push_parse(stream, buf, len, chunks[i]);
+		failed += check_tree(tree, expected, path, "json_stream");
+		syntax_tree_delete(tree);
+		json_stream_delete(stream);
+	}
+
+	json_document *doc = json_document_create();
+	json_stream *stream = doc != NULL ? json_stream_create(doc) : NULL;
+	failed += check_tree(push_parse(stream, buf, len, 0), expected, path, "json_stream document");
+	json_stream_delete(stream);
+	json_document_delete(doc);
+	return failed;
+}
+
+/**
+ * @brief Create a temporary file
+ *
+ * @param[in,out] name The name template ending in XXXXXX, replaced by the name of the file
+ * @return The file opened for writing or NULL if could not create
+ */
+static FILE *temp_file(char *name)
+{
+	int fd = mkstemp(name);
+	FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if (f == NULL && fd >= 0)
+	{
+		close(fd);
+		unlink(name);
+	}
+	return f;
+}
+
+/**
+ * @brief state of the parallel NDJSON check
+ */
+typedef struct
+{
+	check_output const *expected; ///<\brief the expected output of each record or NULL to only count the valid records
+	size_t records;				  ///<\brief the number of matching records, accessed atomically
+	size_t failed;				  ///<\brief the number of failed records, accessed atomically
+	size_t offset;				  ///<\brief the offset of the last record of an ordered read
+	int stop;					  ///<\brief nonzero to stop reading at the first record
+} ndjson_check;
+
+/**
+ * @brief Check a record of a parallel read
+ *
+ * @param ctx The check state
+ * @param offset The offset of the record
+ * @param root The record
+ * @return 0 to continue, nonzero to stop
+ */
+static int ndjson_record(void *ctx, size_t offset, syntax_tree root)
+{
+	ndjson_check *c = ctx;
+	int same = root != NULL;
+	if (same && c->expected != NULL)
+	{
+		check_output out;
+		if (output_open(&out) != NULL)
+		{
+			syntax_tree_print(root, out.fout);
+			fclose(out.fout);
+		}
+		same = out.fout != NULL && out.len == c->expected->len && memcmp(out.str, c->expected->str, out.len) == 0;
+		free(out.str);
+	}
+	__atomic_add_fetch(same ? &c->records : &c->failed, 1, __ATOMIC_RELAXED);
+	return c->stop;
+}
+
+/**
+ * @brief Check an ordered record of a parallel read
+ *
+ * @param ctx The check state
+ * @param offset The offset of the record
+ * @param root The record
+ * @return 0 to continue, nonzero to stop
+ */
+static int ndjson_ordered_record(void *ctx, size_t offset, syntax_tree root)
+{
+	ndjson_check *c = ctx;
+	if (c->records + c->failed > 0 && offset <= c->offset)
+		c->failed++;
+	c->offset = offset;
+	return ndjson_record(ctx, offset, root);
+}
+
+/**
+ * @brief Check the parallel NDJSON reader with several threads, in and out of order
+ *
+ * @param name The path of the NDJSON file
+ * @param expected The expected output of each record or NULL to only count the valid records
+ * @param records The number of valid records
+ * @param malformed The number of malformed records
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_parallel(char const *name, check_output const *expected, size_t records, size_t malformed, char const *path)
+{
+	int failed = 0;
+	unsigned threads[] = {1, 2, 4};
+	for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+	{
+		for (int ordered = 0; ordered < 2; ordered++)
+		{
+			ndjson_check c = {expected, 0, 0, 0, 0};
+			int ret = json_ndjson_parallel(name, LEX_ZERO_COPY, threads[i], ordered,
+										   ordered ? ndjson_ordered_record : ndjson_record, &c);
+			if (ret != 0 || c.records != records || c.failed != malformed)
+			{
+				fprintf(stderr, "%s: json_ndjson_parallel %s with %u threads differs\n", path,
+						ordered ? "ordered" : "unordered", threads[i]);
+				failed++;
+			}
+			if (records + malformed == 0)
+				continue;
+			// a stopped read delivers at most one more record per worker
+			ndjson_check stop = {NULL, 0, 0, 0, 1};
+			ret = json_ndjson_parallel(name, 0, threads[i], ordered, ordered ? ndjson_ordered_record : ndjson_record, &stop);
+			if (ret == 0 || stop.records + stop.failed == 0 || stop.records + stop.failed > (ordered ? 1 : threads[i]))
+			{
+				fprintf(stderr, "%s: json_ndjson_parallel %s with %u threads does not stop\n", path,
+						ordered ? "ordered" : "unordered", threads[i]);
+				failed++;
+			}
+		}
+	}
+	return failed;
+}
+
+/**
+ * @brief Check the NDJSON readers on a file of the input repeated on single lines
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_ndjson(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	char name[] = "/tmp/check_json_XXXXXX";
+	FILE *f = temp_file(name);
+	if (f == NULL)
+	{
+		fprintf(stderr, "%s: could not create the NDJSON file\n", path);
+		return 1;
+	}
+	// line breaks are white space outside strings and cannot appear inside strings
+	size_t records = 0;
+	for (size_t size = 0; size < NDJSON_MIN_SIZE; size += len + 1)
+	{
+		for (size_t i = 0; i < len; i++)
+			fputc(buf[i] == '\n' || buf[i] == '\r' ? ' ' : buf[i], f);
+		fputs(records % 7 == 3 ? "\n\n" : "\n", f);
+		records++;
+	}
+	int failed = fclose(f) != 0;
+
+	json_ndjson_reader reader;
+	if (json_ndjson_open(&reader, name, LEX_ZERO_COPY) == 0)
+	{
+		syntax_tree root;
+		size_t n = 0;
+		int ret;
+		while ((ret = json_ndjson_next(&reader, &root)) == 1 && check_tree(root, expected, path, "json_ndjson_next") == 0)
+			n++;
+		failed += ret != 0 || n != records;
+		json_ndjson_close(&reader);
+	}
+	else
+		failed++;
+	failed += check_parallel(name, expected, records, 0, path);
+	unlink(name);
+	return failed;
+}
+
+/**
+ * @brief Check the tape document
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param expected The expected output
+ * @param path The checked file
+ * @return The number of failed checks
+ */
+static int check_tape(char const *buf, size_t len, check_output const *expected, char const *path)
+{
+	int failed = 0;
+	json_tape tape;
+	json_tape_init(&tape);
+	// the second build reuses the storage of the first one
+	for (int i = 0; i < 2; i++)
+	{
+		check_output out;
+		if (output_open(&out) != NULL)
+		{
+			out.error = json_tape_build_from_buffer(&tape, buf, len) != 0;
+			if (!out.error)
+				json_tape_print(&tape, out.fout);
+		}
+		failed += output_check(&out, expected, path, "json_tape");
+	}
+	json_tape_free(&tape);
+	return failed;
+}
+
+/**
+ * @brief Check that the kernels agree on escapes and quotes around the block boundaries
+ *
+ * @return The number of failed checks
+ */
+static int check_kernels(void)
+{
+	int failed = structural_index_set_kernel("none") == 0;
+	char const *selected = structural_index_kernel_name();
+	char input[256];
+	for (int pad = 0; pad < 140; pad++)
+	{
+		int len = snprintf(input, sizeof(input), "[\"%*s\\\"\\\\\", \"b\\\\\", {\"k\":\"\\\"\"}]", pad, "");
+		check_output expected;
+		int trailing;
+		structural_index_set_kernel("swar");
+		syntax_tree tree = list_parse(input, (size_t)len, &trailing);
+		if (tree == NULL || output_open(&expected) == NULL)
+		{
+			syntax_tree_delete(tree);
+			failed++;
+			continue;
+		}
+		syntax_tree_print(tree, expected.fout);
+		fclose(expected.fout);
+		syntax_tree_delete(tree);
+		for (size_t i = 1; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+		{
+			if (structural_index_set_kernel(kernels[i]) != 0)
+				continue;
+			tree = list_parse(input, (size_t)len, &trailing);
+			failed += check_tree(tree, &expected, input, kernels[i]);
+			syntax_tree_delete(tree);
+		}
+		free(expected.str);
+	}
+	structural_index_set_kernel(selected);
+	return failed;
+}
+
+/**
+ * @brief Check that the roots of a token list are parsed one after the other
+ *
+ * @return The number of failed checks
+ */
+static int check_roots(void)
+{
+	char const input[] = "[1] {\"a\":[true]} [] [\"x\", {}]";
+	int const children[] = {1, 1, 0, 2};
+	token_list tl = token_list_read_from_buffer(input, strlen(input));
+	token_list end = tl;
+	int failed = tl == NULL;
+	for (size_t i = 0; !failed && i < sizeof(children) / sizeof(children[0]); i++)
+	{
+		syntax_tree tree = parse_json(end, &end);
+		size_t n = 0;
+		for (syntax_tree *c = syntax_tree_first_child(tree); c != NULL; c = syntax_tree_next_sibling(c))
+			n++;
+		failed = tree == NULL || n != (size_t)children[i] || syntax_tree_num_children(tree) != n || (end == NULL) != (i == 3);
+		syntax_tree_delete(tree);
+	}
+	token_list_delete(tl);
+	if (failed)
+		fprintf(stderr, "parse_json: consecutive roots differ\n");
+	return failed;
+}
+
+/**
+ * @brief Check the children of a wide array and of a copied tree
+ *
+ * @return The number of failed checks
+ */
+static int check_children(void)
+{
+	static char input[6 * 1000 + 2];
+	size_t len = 0;
+	input[len++] = '[';
+	for (int i = 0; i < 1000; i++)
+		len += (size_t)sprintf(input + len, "%d,", i);
+	input[len - 1] = ']';
+	int trailing;
+	syntax_tree tree = list_parse(input, len, &trailing);
+	syntax_tree copy = syntax_tree_copy(tree);
+	int failed = tree == NULL || syntax_tree_num_children(tree) != 1000 || syntax_tree_num_children(copy) != 1000;
+	int64_t expected = 0;
+	for (syntax_tree *c = syntax_tree_first_child(copy); !failed && c != NULL; c = syntax_tree_next_sibling(c))
+	{
+		int64_t i64;
+		failed = syntax_tree_get_int64(*c, &i64) != 0 || i64 != expected++;
+	}
+	failed = failed || expected != 1000;
+	if (failed)
+		fprintf(stderr, "syntax_tree: children of a wide array differ\n");
+	syntax_tree_delete(copy);
+	syntax_tree_delete(tree);
+	return failed;
+}
+
+/**
+ * @brief Check the field lookup of an object
+ *
+ * @param object The object with the fields "k0".."k<n-1>" set to their index and a repeated "k0"
+ * @param n The number of distinct fields
+ * @return 0 if every field is found, 1 if not
+ */
+static int check_fields(syntax_tree object, int n)
+{
+	char name[16];
+	for (int i = 0; i < n; i++)
+	{
+		snprintf(name, sizeof(name), "k%d", i);
+		int64_t value;
+		if (syntax_tree_get_int64(syntax_tree_get_field(object, name), &value) != 0 || value != i)
+			return 1;
+	}
+	return syntax_tree_get_field(object, "missing") != NULL || syntax_tree_get_field(object, "k") != NULL;
+}
+
+/**
+ * @brief Check the field lookup on small and indexed objects
+ *
+ * @return The number of failed checks
+ */
+static int check_objects(void)
+{
+	static int const sizes[] = {1, SYNTAX_TREE_INDEX_THRESHOLD - 1, SYNTAX_TREE_INDEX_THRESHOLD, 1000};
+	static char input[16 * 1000 + 16];
+	int failed = 0;
+	json_document *doc = json_document_create();
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		int n = sizes[i];
+		size_t len = 0;
+		input[len++] = '{';
+		for (int k = 0; k < n; k++)
+			len += (size_t)sprintf(input + len, "\"k%d\":%d,", k, k);
+		// the first of the repeated fields is found
+		len += (size_t)sprintf(input + len, "\"k0\":-1}");
+		int trailing;
+		syntax_tree tree = list_parse(input, len, &trailing);
+		syntax_tree copy = syntax_tree_copy(tree);
+		int f = tree == NULL || check_fields(tree, n) || check_fields(tree, n) || check_fields(copy, n);
+		// the index is dropped by a new field
+		char field[32];
+		int field_len = snprintf(field, sizeof(field), "{\"k%d\":%d}", n, n);
+		syntax_tree added = list_parse(field, (size_t)field_len, &trailing);
+		syntax_tree *pair = syntax_tree_first_child(added);
+		syntax_tree pair_copy = pair != NULL ? syntax_tree_copy(*pair) : NULL;
+		if (copy == NULL || syntax_tree_add_child(copy, pair_copy) != 0)
+		{
+			syntax_tree_delete(pair_copy);
+			pair_copy = NULL;
+		}
+		f = f || pair_copy == NULL || check_fields(copy, n + 1);
+		syntax_tree_delete(added);
+		f = f || doc == NULL || check_fields(json_document_parse_buffer(doc, input, len, 0), n);
+		failed += f;
+		if (f)
+			fprintf(stderr, "syntax_tree_get_field: fields of an object with %d fields differ\n", n);
+		syntax_tree_delete(copy);
+		syntax_tree_delete(tree);
+	}
+	json_document_delete(doc);
+	return failed;
+}
+
+/**
+ * @brief Check that the keys of a document are interned
+ *
+ * @return The number of failed checks
+ */
+static int check_interning(void)
+{
+	char const input[] = "[{\"a\":1,\"b\":2},{\"b\":3,\"\\u0061\":4},{\"c\":5}]";
+	char const next[] = "{\"x\":6}";
+	json_document *doc = json_document_create();
+	syntax_tree root = doc != NULL ? json_document_parse_buffer(doc, input, strlen(input), LEX_ZERO_COPY) : NULL;
+	int failed = syntax_tree_num_children(root) != 3;
+	if (!failed)
+	{
+		syntax_tree first = root->children[0];
+		syntax_tree second = root->children[1];
+		syntax_tree a0 = first->children[0]->children[0];
+		syntax_tree a1 = second->children[1]->children[0];
+		int64_t value;
+		failed = !(a0->flags & SYNTAX_FLAG_INTERNED) || a0->data.string.ptr != a1->data.string.ptr;
+		failed += syntax_tree_get_int64(syntax_tree_get_field(second, "a"), &value) != 0 || value != 4;
+		failed += syntax_tree_get_field(first, "c") != NULL || syntax_tree_get_field(first, "x") != NULL;
+		failed += syntax_tree_get_int64(syntax_tree_get_field(root->children[2], "c"), &value) != 0 || value != 5;
+		// the pool is emptied by the next parse
+		root = json_document_parse_buffer(doc, next, strlen(next), 0);
+		failed += syntax_tree_get_field(root, "a") != NULL;
+		failed += syntax_tree_get_int64(syntax_tree_get_field(root, "x"), &value) != 0 || value != 6;
+	}
+	if (failed)
+		fprintf(stderr, "json_document: interned keys differ\n");
+	json_document_delete(doc);
+	return failed;
+}
+
+/**
+ * @brief Check the identifiers of the value dictionary
+ *
+ * @return The number of failed checks
+ */
+static int check_dictionary(void)
+{
+	char const input[] = "[\"x\",\"y\",\"x\",\"\\u0078\",{\"k\":\"y\"},\"z\"]";
+	size_t const ids[] = {0, 1, 0, 0, 1, 2};
+	json_document *doc = json_document_create();
+	syntax_tree root = doc != NULL ? json_document_parse_buffer(doc, input, strlen(input), 0) : NULL;
+	size_t id;
+	// the dictionary is disabled by default
+	int failed = root == NULL || syntax_tree_get_string_id(root->children[0], &id) == 0;
+	if (!failed)
+	{
+		json_document_set_dictionary(doc, 1);
+		root = json_document_parse_buffer(doc, input, strlen(input), 0);
+		for (size_t i = 0; !failed && i < sizeof(ids) / sizeof(ids[0]); i++)
+		{
+			syntax_tree value = root->children[i];
+			if (value->type == syntax_object)
+				value = syntax_tree_get_field(value, "k");
+			failed = syntax_tree_get_string_id(value, &id) != 0 || id != ids[i];
+		}
+		failed += syntax_tree_get_string_id(root, &id) == 0;
+	}
+	int trailing;
+	syntax_tree tree = list_parse(input, strlen(input), &trailing);
+	failed += tree == NULL || syntax_tree_get_string_id(tree->children[0], &id) == 0;
+	syntax_tree_delete(tree);
+	if (failed)
+		fprintf(stderr, "json_document: dictionary identifiers differ\n");
+	json_document_delete(doc);
+	return failed;
+}
+
+/**
+ * @brief Check the on demand lookups of fields and elements
+ *
+ * @return The number of failed checks
+ */
+static int check_navigation(void)
+{
+	char const input[] = "{\"a\":[10,[20],{\"b\":\"x\"}],\"c\":true,\"d\":-3.5}";
+	json_ondemand_doc doc;
+	json_ondemand_init(&doc);
+	json_ondemand_value root, a, c, d, b, v;
+	json_ondemand_root(&doc, &root);
+	int64_t i64;
+	double number;
+	int flag;
+	token_t tok;
+	int failed = json_ondemand_parse(&doc, input, strlen(input), LEX_ZERO_COPY) != 0;
+	if (!failed)
+	{
+		// the later fields are found without reading the skipped values
+		failed += json_ondemand_get_field(&root, "d", &d) != 0 || json_ondemand_get_double(&d, &number) != 0 || number != -3.5;
+		failed += json_ondemand_get_field(&root, "c", &c) != 0 || json_ondemand_get_bool(&c, &flag) != 0 || !flag;
+		failed += json_ondemand_get_field(&root, "a", &a) != 0 || json_ondemand_at(&a, 0, &v) != 0 ||
+				  json_ondemand_get_int64(&v, &i64) != 0 || i64 != 10;
+		failed += json_ondemand_at(&a, 2, &v) != 0 || json_ondemand_get_field(&v, "b", &b) != 0 ||
+				  json_ondemand_get_string(&b, &tok) != 0 || tok.value.string.len != 1 || tok.value.string.ptr[0] != 'x';
+		failed += json_ondemand_at(&a, 3, &v) == 0 || json_ondemand_get_field(&root, "b", &v) == 0;
+		failed += json_ondemand_get_field(&a, "a", &v) == 0 || json_ondemand_at(&root, 0, &v) == 0;
+		failed += json_ondemand_get_int64(&d, &i64) == 0 || json_ondemand_get_bool(&d, &flag) == 0 || json_ondemand_is_null(&d);
+	}
+	if (failed)
+		fprintf(stderr, "json_ondemand: lookups differ\n");
+	json_ondemand_free(&doc);
+	return failed;
+}
+
+/**
+ * @brief Check that a number is lexed to the nearest double
+ *
+ * @param num The text of the number
+ * @return 0 if the number is the same as the one of strtod, 1 if not
+ */
+static int check_number(char const *num)
+{
+	char input[64];
+	int len = snprintf(input, sizeof(input), "[%s]", num);
+	token_tape *tape = token_tape_read_from_buffer(input, (size_t)len, 0);
+	token_t const *tok = tape != NULL ? token_tape_get(tape, 1) : NULL;
+	double expected = strtod(num, NULL);
+	int same = tok != NULL && tok->type == TOKEN_NUMBER && memcmp(&tok->value.number, &expected, sizeof(double)) == 0;
+	token_tape_delete(tape);
+	if (!same)
+		fprintf(stderr, "number: %s differs from strtod\n", num);
+	return !same;
+}
+
+/**
+ * @brief Check the number parser on the hard cases and on random numbers
+ *
+ * @return The number of failed checks
+ */
+static int check_numbers(void)
+{
+	static char const *const hard[] = {
+		"0e0", "-0", "0.1", "1e23", "8.98846567431158e307", "1.7976931348623157e308", "1.7976931348623159e308",
+		"1e400", "-1e400", "4.9406564584124654e-324", "2.4703282292062328e-324", "2.4703282292062327e-324",
+		"2.2250738585072011e-308", "2.2250738585072014e-308", "9007199254740993e0", "9007199254740992.5",
+		"123456789012345678901234567890", "0.000000000000000000000000000000000001e-300", "1e-400",
+		"7.038531e-26", "2.22507385850720113605740979670913197593481954225e-308",
+	};
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(hard) / sizeof(hard[0]); i++)
+		failed += check_number(hard[i]);
+	char num[48];
+	for (int i = 0; i < 100000; i++)
+	{
+		int digits = 1 + rand() % 25;
+		int len = 0;
+		if (rand() % 2)
+			num[len++] = '-';
+		num[len++] = '1' + rand() % 9;
+		for (int d = 1; d < digits; d++)
+			num[len++] = '0' + rand() % 10;
+		snprintf(num + len, sizeof(num) - len, "e%d", rand() % 680 - 340);
+		failed += check_number(num);
+	}
+	return failed;
+}
+
+/**
+ * @brief Check the integer kinds and the number getters with eager and lazy numbers
+ *
+ * @return The number of failed checks
+ */
+static int check_integers(void)
+{
+	static struct
+	{
+		char const *num;	 ///<\brief the text of the number
+		syntax_type_t type;	 ///<\brief the expected node type
+		int int64;			 ///<\brief nonzero if the number is read as int64_t
+		int uint64;			 ///<\brief nonzero if the number is read as uint64_t
+	} const cases[] = {
+		{"0", syntax_integer, 1, 1},
+		{"-1", syntax_integer, 1, 0},
+		{"9223372036854775807", syntax_integer, 1, 1},
+		{"-9223372036854775808", syntax_integer, 1, 0},
+		{"9223372036854775808", syntax_unsigned, 0, 1},
+		{"18446744073709551615", syntax_unsigned, 0, 1},
+		{"18446744073709551616", syntax_number, 0, 0},
+		{"-9223372036854775809", syntax_number, 1, 0},
+		{"-0", syntax_number, 1, 1},
+		{"2.5", syntax_number, 0, 0},
+		{"1e3", syntax_number, 1, 1},
+	};
+	int failed = 0;
+	char input[64];
+	for (size_t i = 0; i < 2 * sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		// the second round reads the numbers lazily, the getters convert them
+		size_t k = i % (sizeof(cases) / sizeof(cases[0]));
+		int lazy = i >= sizeof(cases) / sizeof(cases[0]);
+		int len = snprintf(input, sizeof(input), "[%s]", cases[k].num);
+		token_tape *tape = token_tape_read_from_buffer(input, (size_t)len, lazy ? LEX_LAZY_NUMBERS : 0);
+		size_t e;
+		syntax_tree tree = tape != NULL ? parse_json_tape(tape, &e) : NULL;
+		syntax_tree *c = syntax_tree_first_child(tree);
+		int64_t i64;
+		uint64_t u64;
+		double d;
+		int same = c != NULL &&
+				   (syntax_tree_get_int64(*c, &i64) == 0) == cases[k].int64 &&
+				   (syntax_tree_get_uint64(*c, &u64) == 0) == cases[k].uint64 &&
+				   syntax_tree_get_double(*c, &d) == 0 && d == strtod(cases[k].num, NULL) &&
+				   (*c)->type == cases[k].type;
+		if (same && cases[k].int64)
+			same = (double)i64 == d;
+		if (same && cases[k].uint64)
+			same = (double)u64 == d;
+		if (!same)
+		{
+			fprintf(stderr, "number: %s is read differently%s\n", cases[k].num, lazy ? " lazily" : "");
+			failed++;
+		}
+		syntax_tree_delete(tree);
+		token_tape_delete(tape);
+	}
+	return failed;
+}
+
+/**
+ * @brief Check that the malformed inputs are rejected by the token parsers
+ *
+ * @param input The malformed input
+ * @return The number of failed checks
+ */
+static int malformed_tokens(char const *input)
+{
+	size_t len = strlen(input);
+	int failed = 0;
+	int trailing;
+	syntax_tree tree = list_parse(input, len, &trailing);
+	// a complete root followed by more tokens is a valid prefix for parse_json
+	if (tree != NULL && !trailing)
+		failed += accepted(input, "parse_json");
+	syntax_tree_delete(tree);
+
+	size_t end;
+	tree = parse_json_from_buffer(input, len, 0, &end);
+	if (tree != NULL && only_whitespace(input, len, end))
+		failed += accepted(input, "parse_json_from_buffer");
+	syntax_tree_delete(tree);
+
+	char const *selected = structural_index_kernel_name();
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+	{
+		if (structural_index_set_kernel(kernels[i]) != 0)
+			continue;
+		for (int lazy = 0; lazy < 2; lazy++)
+		{
+			token_tape *tape = token_tape_read_from_buffer(input, len, lazy ? LEX_LAZY_NUMBERS : 0);
+			size_t e = 0;
+			tree = tape != NULL ? parse_json_tape(tape, &e) : NULL;
+			if (tree != NULL && e == tape->size)
+				failed += accepted(input, kernels[i]);
+			syntax_tree_delete(tree);
+			token_tape_delete(tape);
+		}
+	}
+	structural_index_set_kernel(selected);
+	return failed;
+}
+
+/**
+ * @brief Check that an arena rejects oversized requests and reuses its kept blocks
+ *
+ * @return The number of failed checks
+ */
+static int check_arena(void)
+{
+	json_arena arena;
+	json_arena_init(&arena);
+	int failed = json_arena_alloc(&arena, SIZE_MAX) != NULL || json_arena_alloc(&arena, SIZE_MAX - 3) != NULL;
+	size_t blocks = 0;
+	for (int round = 0; round < 4; round++)
+	{
+		// the requests skip the smaller kept blocks and come back to them
+		json_arena_reset(&arena);
+		static size_t const sizes[] = {10, 200000, 100000, 60000, 300000, 60000};
+		for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		{
+			unsigned char *p = json_arena_alloc(&arena, sizes[i]);
+			if (p == NULL)
+				failed++;
+			else
+				memset(p, 0xA5, sizes[i]);
+		}
+		size_t n = 0;
+		for (json_arena_block *b = arena.first; b != NULL; b = b->next)
+			n++;
+		if (round > 0 && n != blocks)
+			failed++;
+		blocks = n;
+	}
+	json_arena_free(&arena);
+	if (failed)
+		fprintf(stderr, "json_arena: blocks are not reused\n");
+	return failed;
+}
+
+/**
+ * @brief Check that the documents reject the malformed inputs and are usable afterwards
+ *
+ * @return The number of failed checks
+ */
+static int malformed_document(void)
+{
+	json_document *doc = json_document_create();
+	if (doc == NULL)
+		return 1;
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		size_t len = strlen(malformed[i]);
+		if (json_document_parse_buffer(doc, malformed[i], len, 0) != NULL)
+			failed += accepted(malformed[i], "json_document");
+		if (json_document_parse_buffer(doc, malformed[i], len, LEX_ZERO_COPY | LEX_LAZY_NUMBERS) != NULL)
+			failed += accepted(malformed[i], "json_document lazy");
+	}
+	char const valid[] = "{\"a\":[1,\"b\"]}";
+	syntax_tree tree = json_document_parse_buffer(doc, valid, strlen(valid), 0);
+	if (syntax_tree_num_children(syntax_tree_get_field(tree, "a")) != 2)
+	{
+		fprintf(stderr, "json_document: could not parse after the malformed inputs\n");
+		failed++;
+	}
+	// the nodes of a document are not extended
+	syntax_tree child = syntax_tree_copy(tree);
+	if (tree != NULL && syntax_tree_add_child(tree, child) == 0)
+	{
+		fprintf(stderr, "json_document: syntax_tree_add_child extends a document tree\n");
+		failed++;
+	}
+	else
+		syntax_tree_delete(child);
+	json_document_delete(doc);
+
+	json_ondemand_doc ondemand;
+	json_ondemand_init(&ondemand);
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		// scalar roots are navigable, the characters after the root are not visited
+		int trailing;
+		syntax_tree tree = list_parse(malformed[i], strlen(malformed[i]), &trailing);
+		syntax_tree_delete(tree);
+		json_ondemand_value root;
+		json_ondemand_root(&ondemand, &root);
+		check_output out;
+		if ((tree != NULL && trailing) || output_open(&out) == NULL)
+			continue;
+		if (json_ondemand_parse(&ondemand, malformed[i], strlen(malformed[i]), 0) == 0 &&
+			(json_ondemand_type(&root) == TOKEN_BRACKET_ARRAY_OPEN || json_ondemand_type(&root) == TOKEN_BRACKET_OBJECT_OPEN) &&
+			ondemand_print(&root, out.fout, 0) == 0)
+			failed += accepted(malformed[i], "json_ondemand");
+		fclose(out.fout);
+		free(out.str);
+	}
+	json_ondemand_free(&ondemand);
+
+	json_tape tape;
+	json_tape_init(&tape);
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		if (json_tape_build_from_buffer(&tape, malformed[i], strlen(malformed[i])) == 0)
+			failed += accepted(malformed[i], "json_tape");
+	}
+	int64_t first;
+	if (json_tape_build_from_buffer(&tape, valid, strlen(valid)) != 0 ||
+		json_tape_get_int64(&tape, json_tape_first_child(&tape, json_tape_get_field(&tape, 0, "a")), &first) != 0 || first != 1)
+	{
+		fprintf(stderr, "json_tape: could not build after the malformed inputs\n");
+		failed++;
+	}
+	json_tape_free(&tape);
+	return failed;
+}
+
+/**
+ * @brief Create an array nested to a given depth
+ *
+ * @param depth The number of nested arrays
+ * @param[out] len The number of characters
+ * @return The dynamically allocated characters or NULL if could not allocate
+ */
+static char *nested_arrays(size_t depth, size_t *len)
+{
+	char *buf = malloc(2 * depth);
+	if (buf == NULL)
+		return NULL;
+	memset(buf, '[', depth);
+	memset(buf + depth, ']', depth);
+	*len = 2 * depth;
+	return buf;
+}
+
+/**
+ * @brief Check the nesting limit of the tape document
+ *
+ * @return The number of failed checks
+ */
+static int check_tape_depth(void)
+{
+	json_tape tape;
+	json_tape_init(&tape);
+	size_t len;
+	char *deep = nested_arrays(JSON_TAPE_MAX_DEPTH, &len);
+	char *deeper = nested_arrays(JSON_TAPE_MAX_DEPTH + 1, &len);
+	int failed = deep == NULL || deeper == NULL;
+	if (!failed)
+	{
+		check_output out;
+		// the printer is not recursive either
+		if (output_open(&out) != NULL && json_tape_build_from_buffer(&tape, deep, 2 * JSON_TAPE_MAX_DEPTH) == 0)
+			json_tape_print(&tape, out.fout);
+		if (out.fout != NULL)
+			fclose(out.fout);
+		failed = out.fout == NULL || tape.size != 2 * JSON_TAPE_MAX_DEPTH;
+		free(out.str);
+		failed += json_tape_build_from_buffer(&tape, deeper, len) == 0;
+		failed += json_tape_set_max_depth(&tape, 0) == 0;
+		failed += json_tape_set_max_depth(&tape, 3) != 0 || json_tape_build_from_buffer(&tape, "[[{}]]", 6) != 0;
+		failed += json_tape_build_from_buffer(&tape, "[[[[]]]]", 8) == 0;
+	}
+	if (failed)
+		fprintf(stderr, "json_tape: the depth limit differs\n");
+	free(deeper);
+	free(deep);
+	json_tape_free(&tape);
+	return failed;
+}
+
+/**
+ * @brief Check the nesting limit of the tree parsers
+ *
+ * @return The number of failed checks
+ */
+static int check_depth(void)
+{
+	size_t len;
+	size_t deeper_len;
+	size_t deepest_len;
+	char *deep = nested_arrays(PARSE_JSON_MAX_DEPTH, &len);
+	char *deeper = nested_arrays(PARSE_JSON_MAX_DEPTH + 1, &deeper_len);
+	// far beyond the limit, a recursive parser would overflow the stack
+	char *deepest = nested_arrays(1000000, &deepest_len);
+	json_document *doc = json_document_create();
+	int failed = deep == NULL || deeper == NULL || deepest == NULL || doc == NULL;
+	if (!failed)
+	{
+		size_t end;
+		syntax_tree tree = parse_json_from_buffer(deep, len, 0, &end);
+		syntax_tree copy = syntax_tree_copy(tree);
+		check_output out;
+		if (output_open(&out) != NULL)
+		{
+			syntax_tree_print(copy, out.fout);
+			fclose(out.fout);
+			free(out.str);
+		}
+		failed = tree == NULL || copy == NULL || out.fout == NULL || out.len != PARSE_JSON_MAX_DEPTH * (PARSE_JSON_MAX_DEPTH + 15) / 2;
+		syntax_tree_delete(copy);
+		syntax_tree_delete(tree);
+
+		char const *inputs[] = {deeper, deepest};
+		size_t const lens[] = {deeper_len, deepest_len};
+		for (size_t i = 0; i < 2; i++)
+		{
+			tree = parse_json_from_buffer(inputs[i], lens[i], 0, &end);
+			token_tape *tape = token_tape_read_from_buffer(inputs[i], lens[i], 0);
+			syntax_tree from_tape = tape != NULL ? parse_json_tape(tape, &end) : NULL;
+			failed += tree != NULL || tape == NULL || from_tape != NULL;
+			failed += json_document_parse_buffer(doc, inputs[i], lens[i], 0) != NULL;
+			syntax_tree_delete(from_tape);
+			token_tape_delete(tape);
+			syntax_tree_delete(tree);
+		}
+
+		failed += json_document_set_max_depth(doc, 0) == 0;
+		failed += json_document_set_max_depth(doc, 3) != 0 || json_document_parse_buffer(doc, "[[{}]]", 6, 0) == NULL;
+		failed += json_document_parse_buffer(doc, "[[[[]]]]", 8, 0) != NULL;
+	}
+	if (failed)
+		fprintf(stderr, "parse_json: the depth limit differs\n");
+	json_document_delete(doc);
+	free(deepest);
+	free(deeper);
+	free(deep);
+	return failed;
+}
+
+/**
+ * @brief Count the integer events and stop at the second one
+ *
+ * @param ctx The number of integer events
+ * @param value The integer
+ * @return 0 to continue, 1 to stop
+ */
+static int sax_stop(void *ctx, int64_t value)
+{
+	return ++*(int *)ctx == 2;
+}
+
+/**
+ * @brief Append a key or a string to a buffer, the event callback of the escape check
+ *
+ * @param ctx The buffer, a zero terminated string
+ * @param str The string
+ * @return 0
+ */
+static int sax_append(void *ctx, json_string str)
+{
+	strncat(ctx, str.ptr, str.len);
+	strcat(ctx, "|");
+	return 0;
+}
+
+/**
+ * @brief Check that the event parser rejects the malformed inputs, deep nesting and stops on request
+ *
+ * @return The number of failed checks
+ */
+static int malformed_sax(void)
+{
+	json_sax_handler const none = {NULL};
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		if (json_sax_parse(malformed[i], strlen(malformed[i]), &none, NULL) == 0)
+			failed += accepted(malformed[i], "json_sax");
+	}
+	size_t len;
+	size_t deeper_len;
+	char *deep = nested_arrays(JSON_SAX_MAX_DEPTH, &len);
+	char *deeper = nested_arrays(JSON_SAX_MAX_DEPTH + 1, &deeper_len);
+	int depth_failed = deep == NULL || deeper == NULL || json_sax_parse(deep, len, &none, NULL) != 0 ||
+					   json_sax_parse(deeper, deeper_len, &none, NULL) == 0;
+	free(deeper);
+	free(deep);
+
+	json_sax_handler stop = {NULL};
+	stop.integer = sax_stop;
+	int integers = 0;
+	char const input[] = "[1,2,3]";
+	depth_failed += json_sax_parse(input, strlen(input), &stop, &integers) == 0 || integers != 2;
+	if (depth_failed)
+		fprintf(stderr, "json_sax: the depth limit or the stop differs\n");
+
+	// escaped keys and strings are decoded, the shorter ones into the same scratch buffer
+	json_sax_handler append = {NULL};
+	append.key = sax_append;
+	append.string = sax_append;
+	char decoded[64] = "";
+	char const escaped[] = "{\"a\\nb\":[\"\\u00e9\",\"plain\",\"x\\\"y\"],\"\\ud83d\\ude00\":\"\\/\"}";
+	if (json_sax_parse(escaped, strlen(escaped), &append, decoded) != 0 ||
+		strcmp(decoded, "a\nb|\xc3\xa9|plain|x\"y|\xf0\x9f\x98\x80|/|") != 0)
+	{
+		fprintf(stderr, "json_sax: the escaped strings differ\n");
+		failed++;
+	}
+	return failed + depth_failed;
+}
+
+/**
+ * @brief Check the push parser on split tokens, truncated, malformed and too deep inputs
+ *
+ * @return The number of failed checks
+ */
+static int malformed_push(void)
+{
+	// every token kind is split at every position
+	char const input[] = "[\"a\\u00e9b\\\"c\\\\\",\"\\ud83d\\ude00\",{\"key\":-12.5e3},true,false,null,18446744073709551615]";
+	size_t len = strlen(input);
+	int trailing;
+	syntax_tree tree = list_parse(input, len, &trailing);
+	check_output expected;
+	if (tree == NULL || output_open(&expected) == NULL)
+	{
+		syntax_tree_delete(tree);
+		return 1;
+	}
+	syntax_tree_print(tree, expected.fout);
+	fclose(expected.fout);
+	syntax_tree_delete(tree);
+
+	int failed = 0;
+	for (size_t split = 0; split <= len; split++)
+	{
+		json_stream *stream = json_stream_create(NULL);
+		tree = NULL;
+		if (stream != NULL && json_stream_feed(stream, input, split) == 0 && json_stream_feed(stream, input + split, len - split) == 0)
+			tree = json_stream_finish(stream);
+		failed += check_tree(tree, &expected, "split input", "json_stream");
+		syntax_tree_delete(tree);
+		json_stream_delete(stream);
+
+		// a truncated input is incomplete
+		stream = json_stream_create(NULL);
+		tree = stream != NULL && split < len && json_stream_feed(stream, input, split) == 0 ? json_stream_finish(stream) : NULL;
+		if (tree != NULL)
+		{
+			fprintf(stderr, "json_stream: accepts the first %zu characters\n", split);
+			failed++;
+		}
+		syntax_tree_delete(tree);
+		json_stream_delete(stream);
+	}
+	free(expected.str);
+
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+	{
+		json_stream *stream = json_stream_create(NULL);
+		tree = push_parse(stream, malformed[i], strlen(malformed[i]), 1);
+		if (tree != NULL)
+			failed += accepted(malformed[i], "json_stream");
+		syntax_tree_delete(tree);
+		json_stream_delete(stream);
+	}
+
+	size_t deeper_len;
+	char *deeper = nested_arrays(PARSE_JSON_MAX_DEPTH + 1, &deeper_len);
+	json_stream *stream = json_stream_create(NULL);
+	tree = deeper != NULL ? push_parse(stream, deeper, deeper_len, 0) : NULL;
+	if (deeper == NULL || tree != NULL)
+	{
+		fprintf(stderr, "json_stream: the depth limit differs\n");
+		failed++;
+	}
+	syntax_tree_delete(tree);
+	json_stream_delete(stream);
+	free(deeper);
+
+	// the chunks after an error are rejected
+	stream = json_stream_create(NULL);
+	if (stream == NULL || json_stream_feed(stream, "[1,,", 4) == 0 || json_stream_feed(stream, "2]", 2) == 0 ||
+		json_stream_finish(stream) != NULL)
+	{
+		fprintf(stderr, "json_stream: continues after an error\n");
+		failed++;
+	}
+	json_stream_delete(stream);
+	return failed;
+}
+
+/**
+ * @brief Check that the NDJSON readers report the malformed records and read an empty file
+ *
+ * @return The number of failed checks
+ */
+static int malformed_ndjson(void)
+{
+	static char const lines[] = "[1]\n[1,\n\n{\"a\":2}\n[tru]\n{\"a\":1 \"b\":2}\n[3] [4]\n  [3]\n";
+	static int const results[] = {1, -1, 1, -1, -1, -1, 1, 0};
+	int failed = 0;
+	for (int empty = 0; empty < 2; empty++)
+	{
+		char name[] = "/tmp/check_json_XXXXXX";
+		FILE *f = temp_file(name);
+		if (f == NULL || (!empty && fputs(lines, f) < 0) || fclose(f) != 0)
+		{
+			fprintf(stderr, "json_ndjson: could not create the NDJSON file\n");
+			failed++;
+			continue;
+		}
+		json_ndjson_reader reader;
+		if (json_ndjson_open(&reader, name, 0) == 0)
+		{
+			// the reader continues after a malformed record
+			syntax_tree root;
+			size_t n = empty ? sizeof(results) / sizeof(results[0]) - 1 : 0;
+			while (n < sizeof(results) / sizeof(results[0]) && json_ndjson_next(&reader, &root) == results[n])
+				n++;
+			if (n != sizeof(results) / sizeof(results[0]))
+			{
+				fprintf(stderr, "json_ndjson: record %zu of the %s file differs\n", n, empty ? "empty" : "malformed");
+				failed++;
+			}
+			json_ndjson_close(&reader);
+		}
+		else
+			failed++;
+		// the malformed records are delivered without a tree
+		failed += check_parallel(name, NULL, empty ? 0 : 3, empty ? 0 : 4, empty ? "empty file" : "malformed file");
+		unlink(name);
+	}
+	return failed;
+}
+
+/**
+ * @brief Check that the malformed inputs are rejected
+ *
+ * @return The number of failed checks
+ */
+static int check_malformed(void)
+{
+	int failed = check_roots();
+	failed += check_children();
+	failed += check_objects();
+	failed += check_interning();
+	failed += check_dictionary();
+	failed += check_navigation();
+	failed += check_numbers();
+	failed += check_integers();
+	failed += check_kernels();
+	failed += check_arena();
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+		failed += malformed_tokens(malformed[i]);
+	failed += malformed_document();
+	failed += check_tape_depth();
+	failed += check_depth();
+	failed += malformed_sax();
+	failed += check_stream();
+	failed += check_stream_window();
+	failed += malformed_push();
+	failed += malformed_ndjson();
+	printf("malformed input: %s\n", failed == 0 ? "ok" : "FAILED");
+	return failed;
+}
+
+/**
+ * @brief Read a file into memory
+ *
+ * @param path The path of the file
+ * @param[out] len The number of characters read
+ * @return The dynamically allocated characters or NULL if could not read the file
+ */
+static char *read_file(char const *path, size_t *len)
+{
+	FILE *fin = fopen(path, "rb");
+	if (fin == NULL)
+		return NULL;
+	char *buf = NULL;
+	if (fseek(fin, 0, SEEK_END) == 0)
+	{
+		long size = ftell(fin);
+		buf = size >= 0 ? malloc((size_t)size + 1) : NULL;
+		*len = (size_t)size;
+		rewind(fin);
+		if (buf != NULL && fread(buf, 1, *len, fin) != *len)
+		{
+			free(buf);
+			buf = NULL;
+		}
+	}
+	fclose(fin);
+	return buf;
+}
+
+/**
+ * @brief Check a file with every parser
+ *
+ * @param path The path of the file
+ * @return The number of failed checks
+ */
+static int check_file(char const *path)
+{
+	size_t len;
+	char *buf = read_file(path, &len);
+	check_output expected;
+	int trailing;
+	syntax_tree tree = buf != NULL ? list_parse(buf, len, &trailing) : NULL;
+	if (tree == NULL || output_open(&expected) == NULL)
+	{
+		fprintf(stderr, "%s: could not parse the file\n", path);
+		syntax_tree_delete(tree);
+		free(buf);
+		return 1;
+	}
+	syntax_tree_print(tree, expected.fout);
+	fclose(expected.fout);
+	syntax_tree_delete(tree);
+
+	int failed = check_tokens(buf, len, &expected, path);
+	failed += check_pull(buf, len, &expected, path);
+	failed += check_document(buf, len, &expected, path);
+	failed += check_tape(buf, len, &expected, path);
+	failed += check_ondemand(buf, len, &expected, path);
+	failed += check_sax(buf, len, &expected, path);
+	failed += check_lexer(buf, len, path);
+	failed += check_push(buf, len, &expected, path);
+	failed += check_ndjson(buf, len, &expected, path);
+	printf("%s: %s\n", path, failed == 0 ? "ok" : "FAILED");
+	free(expected.str);
+	free(buf);
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stdout, "Usage: %s input_json...\n", argv[0]);
+		return 0;
+	}
+	// the random inputs are the same in every run
+	srand(1);
+	int failed = check_malformed();
+	for (int i = 1; i < argc; i++)
+		failed += check_file(argv[i]);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file hash_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the seeded string hash
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "hash_json.h"
+
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+
+/**
+ * @brief states of the hash seed
+ */
+enum
+{
+	SEED_UNSET,		   ///<\brief no seed has been drawn yet
+	SEED_INITIALIZING, ///<\brief a thread is drawing the seed
+	SEED_READY		   ///<\brief the seed can be used
+};
+
+static uint64_t hash_key[2];		///<\brief the 128 bit SipHash key
+static int hash_key_state = SEED_UNSET; ///<\brief the state of the key
+
+/**
+ * @brief Draw a random hash key
+ *
+ * The time and addresses are mixed in if the system has no random source
+ * or its entropy pool is not initialized yet, the key is never waited for.
+ *
+ * @param key The key to fill
+ */
+static void draw_key(uint64_t key[2])
+{
+	if (getrandom(key, 2 * sizeof(uint64_t), GRND_NONBLOCK) == 2 * sizeof(uint64_t))
+		return;
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	key[0] = (uint64_t)ts.tv_nsec * UINT64_C(0x9e3779b97f4a7c15) ^ (uint64_t)ts.tv_sec;
+	key[1] = (uint64_t)(uintptr_t)key * UINT64_C(0xbf58476d1ce4e5b9) ^ (uint64_t)(uintptr_t)&draw_key;
+}
+
+/**
+ * @brief Get the hash key, drawing it at the first use
+ *
+ * @return Pointer to the key
+ */
+static uint64_t const *get_key(void)
+{
+	int state = __atomic_load_n(&hash_key_state, __ATOMIC_ACQUIRE);
+	if (state == SEED_READY)
+		return hash_key;
+	int expected = SEED_UNSET;
+	if (__atomic_compare_exchange_n(&hash_key_state, &expected, SEED_INITIALIZING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+	{
+		draw_key(hash_key);
+		__atomic_store_n(&hash_key_state, SEED_READY, __ATOMIC_RELEASE);
+		return hash_key;
+	}
+	// another thread is drawing the key
+	while (__atomic_load_n(&hash_key_state, __ATOMIC_ACQUIRE) != SEED_READY)
+		;
+	return hash_key;
+}
+
+void json_hash_set_seed(uint64_t k0, uint64_t k1)
+{
+	hash_key[0] = k0;
+	hash_key[1] = k1;
+	__atomic_store_n(&hash_key_state, SEED_READY, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Rotate a 64 bit word left
+ *
+ * @param x The word
+ * @param b The number of bits
+ * @return The rotated word
+ */
+static uint64_t rotl(uint64_t x, int b)
+{
+	return x << b | x >> (64 - b);
+}
+
+/**
+ * @brief One SipHash round
+ *
+ * @param v The internal state
+ */
+static void sip_round(uint64_t v[4])
+{
+	v[0] += v[1];
+	v[1] = rotl(v[1], 13);
+	v[1] ^= v[0];
+	v[0] = rotl(v[0], 32);
+	v[2] += v[3];
+	v[3] = rotl(v[3], 16);
+	v[3] ^= v[2];
+	v[0] += v[3];
+	v[3] = rotl(v[3], 21);
+	v[3] ^= v[0];
+	v[2] += v[1];
+	v[1] = rotl(v[1], 17);
+	v[1] ^= v[2];
+	v[2] = rotl(v[2], 32);
+}
+
+uint64_t json_hash(char const *str, size_t len)
+{
+	uint64_t const *key = get_key();
+	uint64_t v[4] = {
+		key[0] ^ UINT64_C(0x736f6d6570736575),
+		key[1] ^ UINT64_C(0x646f72616e646f6d),
+		key[0] ^ UINT64_C(0x6c7967656e657261),
+		key[1] ^ UINT64_C(0x7465646279746573)};
+
+	// the words are read in little endian order
+	size_t n = len & ~(size_t)7;
+	for (size_t i = 0; i < n; i += 8)
+	{
+		uint64_t m = 0;
+		for (int j = 7; j >= 0; j--)
+			m = m << 8 | (unsigned char)str[i + j];
+		v[3] ^= m;
+		sip_round(v);
+		v[0] ^= m;
+	}
+	uint64_t b = (uint64_t)len << 56;
+	for (size_t j = len - n; j-- > 0;)
+		b |= (uint64_t)(unsigned char)str[n + j] << (8 * j);
+	v[3] ^= b;
+	sip_round(v);
+	v[0] ^= b;
+
+	v[2] ^= 0xff;
+	sip_round(v);
+	sip_round(v);
+	sip_round(v);
+	return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
@@ -0,0 +1,40 @@
+/**
+ * @file hash_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief seeded string hashing of the JSON library
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef HASH_JSON_H_INCLUDED
+#define HASH_JSON_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Compute the seeded hash of a character string
+ *
+ * The hash is SipHash-1-3 keyed with a random seed drawn at the first use,
+ * so the hash values of the keys cannot be predicted by the producer of the input.
+ *
+ * @param str The characters
+ * @param len The number of characters
+ * @return The 64 bit hash value
+ */
+uint64_t json_hash(char const *str, size_t len);
+
+/**
+ * @brief Set the seed of the string hash
+ *
+ * Intended for reproducible tests, the seed must be set before the first hash is computed.
+ *
+ * @param k0 The first half of the 128 bit key
+ * @param k1 The second half of the 128 bit key
+ */
+void json_hash_set_seed(uint64_t k0, uint64_t k1);
+
+#endif // HASH_JSON_H_INCLUDED
@@ -10,8 +10,10 @@
  */
 
 #ifndef LEX_JSON_H_INCLUDED
-#define LEX_JSON_H_INCLDUED
+#define LEX_JSON_H_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 /**
@@ -26,23 +28,64 @@ typedef enum
 	TOKEN_PUNCTUATOR_COLON,		// :
 	TOKEN_PUNCTUATOR_COMMA,		// ,
 	TOKEN_STRING,
-	TOKEN_NUMBER,
+	TOKEN_NUMBER,	// floating point number
+	TOKEN_INTEGER,	// integer that fits in int64_t
+	TOKEN_UNSIGNED, // integer above INT64_MAX that fits in uint64_t
 	TOKEN_TRUE,
 	TOKEN_FALSE,
 	TOKEN_NULL
 } token_type_t;
 
+/**
+ * @brief lexer flags
+ */
+enum
+{
+	LEX_ZERO_COPY = 1,	  ///<\brief string tokens are views into the input buffer unless they contain escapes
+	LEX_LAZY_NUMBERS = 2, ///<\brief number tokens are validated raw text spans converted on demand
+	LEX_RAW_ESCAPES = 4	  ///<\brief escaped string tokens are undecoded views, only honoured by json_lexer_next over a buffer
+};
+
+/**
+ * @brief token flags
+ */
+enum
+{
+	TOKEN_FLAG_OWNED = 1,	  ///<\brief the token owns the dynamically allocated string body
+	TOKEN_FLAG_RAW_NUMBER = 2, ///<\brief the number token stores its text span, it is not converted yet
+	TOKEN_FLAG_ESCAPED = 4	   ///<\brief the string token is a view of the undecoded body, see json_string_decode
+};
+
+/**
+ * @brief string stored as a pointer and a length
+ * 
+ * Dynamically allocated string bodies are zero terminated,
+ * views into an input buffer are not.
+ */
+typedef struct
+{
+	char const *ptr; ///<\brief pointer to the first character
+	size_t len;		 ///<\brief the number of characters
+} json_string;
+
 /**
  * @brief token structure
  * 
- * The token is stored as an identifier and a generic data.
- * The generic data is needed to store strings or numeric values
+ * The token is stored as an identifier and a union of token data tagged by the identifier.
+ * Strings are stored as dynamic copies or as views into the input buffer, numbers are stored inline.
  */
 typedef struct
 {
-	token_type_t type; ///<\brief the token type
-	void *value;	   ///<\brief generic token data
-	size_t line_cntr;  ///<\brief the line number where the token was parsed
+	token_type_t type;	  ///<\brief the token type
+	unsigned flags;		  ///<\brief the token flags
+	union
+	{
+		json_string string; ///<\brief the decoded string body of a string token or the text of a raw number
+		double number;		///<\brief the value of a floating point number token
+		int64_t integer;	///<\brief the value of an integer token
+		uint64_t uinteger;	///<\brief the value of an unsigned integer token
+	} value;				///<\brief token data tagged by the token type
+	size_t line_cntr;		///<\brief the line number where the token was parsed
 } token_t;
 
 /**
@@ -56,14 +99,298 @@ typedef struct tl
 } token_list_elem;
 typedef token_list_elem *token_list; ///<\brief the token list pointer and list type
 
+/**
+ * @brief contiguous array of tokens
+ * 
+ * The token tape stores the tokens packed in a single growable array,
+ * the tokens are addressed by their position.
+ */
+typedef struct
+{
+	token_t *tokens; ///<\brief the token array
+	size_t size;	 ///<\brief the number of stored tokens
+	size_t capacity; ///<\brief the number of allocated token slots
+} token_tape;
+
+/**
+ * @brief positions of the structural characters of a character buffer
+ * 
+ * The structural positions are the punctuators outside strings, the opening
+ * quotes of strings and the first characters of numbers and keywords,
+ * in increasing order. Each token of the buffer starts at a structural position.
+ */
+typedef struct
+{
+	uint32_t *positions; ///<\brief the structural positions
+	size_t size;		 ///<\brief the number of structural positions
+	size_t capacity;	 ///<\brief the number of allocated position slots
+} structural_index;
+
+/**
+ * @brief pull lexer of a character buffer or stream
+ * 
+ * The lexer reads one token at a time, so no token storage is needed.
+ * A stream is read through a window that is refilled as the tokens are consumed,
+ * it only grows to hold the longest token.
+ */
+typedef struct
+{
+	char const *str; ///<\brief the first unread character
+	char const *end; ///<\brief pointer past the last character of the buffer or of the window
+	unsigned flags;	 ///<\brief bitwise or of LEX_* flags
+	size_t line_cntr; ///<\brief the current line number
+	FILE *fin;		 ///<\brief the input stream or NULL for a buffer lexer
+	char *window;	 ///<\brief the buffered part of the stream
+	size_t capacity; ///<\brief the number of allocated window characters
+	int eof;		 ///<\brief nonzero if the stream is exhausted
+} json_lexer;
+
+/**
+ * @brief Initialize a pull lexer over a character buffer
+ * 
+ * The buffer need not be zero terminated, it must outlive the lexer
+ * and with the LEX_ZERO_COPY, LEX_LAZY_NUMBERS or LEX_RAW_ESCAPES flags the tokens too.
+ * 
+ * @param lexer The lexer
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags
+ */
+void json_lexer_init(json_lexer *lexer, char const *buf, size_t len, unsigned flags);
+
+/**
+ * @brief Initialize a pull lexer over a stream
+ * 
+ * The tokens are read as the stream is consumed, the whole input is never held in memory.
+ * String tokens are always decoded copies and numbers are always converted,
+ * as the window is overwritten by the next refill, so LEX_ZERO_COPY, LEX_LAZY_NUMBERS and LEX_RAW_ESCAPES are ignored.
+ * 
+ * @param lexer The lexer
+ * @param fin The input stream
+ * @param flags Bitwise or of LEX_* flags
+ * @return 0 on success, -1 if could not allocate
+ */
+int json_lexer_init_file(json_lexer *lexer, FILE *fin, unsigned flags);
+
+/**
+ * @brief Release the window of a stream lexer
+ * 
+ * Buffer lexers own no memory, the call is a no-op for them.
+ * 
+ * @param lexer The lexer
+ */
+void json_lexer_free(json_lexer *lexer);
+
+/**
+ * @brief Read the next token of a pull lexer
+ * 
+ * The dynamically allocated string body of the token is owned by the caller,
+ * it is released with token_free.
+ * 
+ * @param lexer The lexer
+ * @param[out] tok The token
+ * @return 1 if a token was read, 0 at the end of the input, -1 if could not read a token or the stream
+ */
+int json_lexer_next(json_lexer *lexer, token_t *tok);
+
+/**
+ * @brief Release the dynamically allocated string body of a token
+ * 
+ * @param tok The token
+ */
+void token_free(token_t *tok);
+
+/**
+ * @brief Decode the escape sequences of a string token read with the LEX_RAW_ESCAPES flag
+ * 
+ * The decoded string is never longer than the escaped one and it is not zero terminated.
+ * 
+ * @param str The undecoded string body of a token with the TOKEN_FLAG_ESCAPED flag
+ * @param[out] out The output buffer of at least str.len characters
+ * @return The number of decoded characters or -1 if an escape sequence is invalid
+ */
+ptrdiff_t json_string_decode(json_string str, char *out);
+
+/**
+ * @brief Initialize an empty structural index
+ * 
+ * @param index The structural index
+ */
+void structural_index_init(structural_index *index);
+
+/**
+ * @brief Build the structural index of a character buffer
+ * 
+ * The buffer is classified in blocks of 64 characters with the SIMD kernel
+ * selected for the processor at run time. The index storage is reused and grown as needed, so an index can be rebuilt
+ * for several buffers.
+ * 
+ * @param index The structural index
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer, at most 4 GiB
+ * @return 0 on success, -1 if the buffer is too large, could not be indexed
+ * or ends inside a string
+ */
+int structural_index_build(structural_index *index, char const *buf, size_t len);
+
+/**
+ * @brief Get the name of the structural indexing kernel
+ * 
+ * The kernel is selected at the first use according to the processor features:
+ * "avx512", "avx2", "sse4.2" or the portable "swar" kernel.
+ * 
+ * @return The name of the selected kernel
+ */
+char const *structural_index_kernel_name(void);
+
+/**
+ * @brief Select a structural indexing kernel by name
+ * 
+ * Intended for benchmarks and tests that compare the kernels.
+ * 
+ * @param name The kernel name as returned by structural_index_kernel_name
+ * @return 0 on success, -1 if the kernel does not exist or is not supported by the processor
+ */
+int structural_index_set_kernel(char const *name);
+
+/**
+ * @brief Release the storage of a structural index
+ * 
+ * @param index The structural index
+ */
+void structural_index_free(structural_index *index);
+
+/**
+ * @brief Read a token tape from a character buffer
+ * 
+ * The buffer is lexed in place, it need not be zero terminated.
+ * With the LEX_ZERO_COPY flag string tokens without escape sequences are views into
+ * the buffer, with the LEX_LAZY_NUMBERS flag number tokens are views into the buffer,
+ * so the buffer must outlive the tape and the syntax trees parsed from it.
+ * 
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags
+ * @return a newly allocated token tape or NULL if could not read tokens
+ */
+token_tape *token_tape_read_from_buffer(char const *buf, size_t len, unsigned flags);
+
+/**
+ * @brief Lex a character buffer into an existing token tape
+ * 
+ * The previous tokens of the tape are released, the storage of the tape and of the
+ * structural index is reused, so repeated calls allocate nothing once the storage is large enough.
+ * The buffer must outlive the tokens as for token_tape_read_from_buffer.
+ * 
+ * @param tape The token tape
+ * @param index The structural index used as scratch storage
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags
+ * @return 0 on success, -1 if could not read tokens
+ */
+int token_tape_lex(token_tape *tape, structural_index *index, char const *buf, size_t len, unsigned flags);
+
+/**
+ * @brief Release the tokens of a token tape and keep its storage
+ * 
+ * @param tape The token tape
+ */
+void token_tape_clear(token_tape *tape);
+
+/**
+ * @brief Map a file into memory for reading
+ * 
+ * @param path The path of the file
+ * @param[out] len The number of mapped characters
+ * @return Pointer to the mapping or NULL if the file could not be mapped, an empty file is mapped as an empty buffer
+ */
+char const *json_map_file(char const *path, size_t *len);
+
+/**
+ * @brief Unmap a file mapped with json_map_file
+ * 
+ * @param map The mapping
+ * @param len The number of mapped characters
+ */
+void json_unmap_file(char const *map, size_t len);
+
+/**
+ * @brief Read a token tape from a memory mapped file
+ * 
+ * @param path The path of the input file
+ * @return a newly allocated token tape or NULL if could not map or read tokens
+ */
+token_tape *token_tape_read_from_mmap(char const *path);
+
+/**
+ * @brief Print a token tape to an output stream
+ * 
+ * @param tape The token tape
+ * @param fout The output stream
+ */
+void token_tape_print(token_tape const *tape, FILE *fout);
+
+/**
+ * @brief Delete a token tape
+ * 
+ * @param tape The token tape
+ */
+void token_tape_delete(token_tape *tape);
+
+/**
+ * @brief Get a token from a token tape
+ * 
+ * @param tape The token tape
+ * @param pos The position of the token
+ * @return Pointer to the stored token or NULL if the position is past the tape end
+ */
+token_t const *token_tape_get(token_tape const *tape, size_t pos);
+
 /**
  * @brief Read a token list from a file
  * 
+ * The whole stream is read into memory and lexed in one pass,
+ * so there is no limit on the line length.
+ * 
  * @param fin The input file
  * @return a token list or NULL if could not read tokens
  */
 token_list token_list_read_from_file(FILE *fin);
 
+/**
+ * @brief Read a token list from a character buffer
+ * 
+ * The buffer is lexed in place, it need not be zero terminated.
+ * 
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @return a token list or NULL if could not read tokens
+ */
+token_list token_list_read_from_buffer(char const *buf, size_t len);
+
+/**
+ * @brief Read a token list from a memory mapped file
+ * 
+ * The file is mapped once and lexed as a single buffer.
+ * 
+ * @param path The path of the input file
+ * @return a token list or NULL if could not map or read tokens
+ */
+token_list token_list_read_from_mmap(char const *path);
+
+/**
+ * @brief Convert a raw number token into its value
+ * 
+ * A TOKEN_NUMBER token read with the LEX_LAZY_NUMBERS flag becomes a TOKEN_NUMBER,
+ * TOKEN_INTEGER or TOKEN_UNSIGNED token with the converted value.
+ * Other tokens are left unchanged.
+ * 
+ * @param tok The token
+ * @return 0 on success, -1 if the token text is not a number
+ */
+int token_materialize_number(token_t *tok);
+
 /**
  * @brief Print a token list to an output stream
  * 
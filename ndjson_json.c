@@ -0,0 +1,570 @@
+/**
+ * @file ndjson_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the newline delimited JSON reader
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "ndjson_json.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int json_ndjson_open(json_ndjson_reader *reader, char const *path, unsigned flags)
+{
+	reader->doc = json_document_create();
+	if (reader->doc == NULL)
+		return -1;
+	reader->map = json_map_file(path, &reader->len);
+	if (reader->map == NULL)
+	{
+		json_document_delete(reader->doc);
+		return -1;
+	}
+	reader->next = reader->map;
+	reader->flags = flags;
+	reader->line = 0;
+	structural_index_init(&reader->index);
+	reader->tape.tokens = NULL;
+	reader->tape.size = reader->tape.capacity = 0;
+	return 0;
+}
+
+/**
+ * @brief Check if a line holds only white space
+ *
+ * @param str The first character of the line
+ * @param end Pointer past the last character of the line
+ * @return Nonzero if the line is blank
+ */
+static int is_blank(char const *str, char const *end)
+{
+	for (; str != end; str++)
+	{
+		if (*str != ' ' && *str != '\t' && *str != '\r')
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * @brief Find the next record
+ * 
+ * Raw new lines cannot appear inside strings, so each line is a record.
+ * 
+ * @param str The first character of a line
+ * @param end Pointer past the last character of the input
+ * @param[out] eol Pointer to the new line ending the record or to the input end
+ * @param[in,out] line The line counter, incremented for each visited line
+ * @return The first character of the record or end if only blank lines are left
+ */
+static char const *next_record(char const *str, char const *end, char const **eol, size_t *line)
+{
+	while (str != end)
+	{
+		(*line)++;
+		*eol = memchr(str, '\n', end - str);
+		if (*eol == NULL)
+			*eol = end;
+		if (!is_blank(str, *eol))
+			return str;
+		str = *eol == end ? end : *eol + 1;
+	}
+	return end;
+}
+
+/**
+ * @brief Lex and parse a record
+ * 
+ * @param index The structural index used as scratch storage
+ * @param tape The token tape used as scratch storage
+ * @param doc The document receiving the tree
+ * @param str The first character of the record
+ * @param eol Pointer past the last character of the record
+ * @param flags Bitwise or of LEX_* flags
+ * @param append Nonzero to keep the previous trees of the document
+ * @return The root of the record or NULL if could not read or interpret
+ */
+static syntax_tree parse_record(structural_index *index, token_tape *tape, json_document *doc,
+								char const *str, char const *eol, unsigned flags, int append)
+{
+	size_t pos;
+	if (token_tape_lex(tape, index, str, eol - str, flags) != 0)
+		return NULL;
+	syntax_tree root = append ? json_document_append_tape(doc, tape, &pos) : json_document_parse_tape(doc, tape, &pos);
+	// a record holds a single root
+	return root != NULL && pos == tape->size ? root : NULL;
+}
+
+int json_ndjson_next(json_ndjson_reader *reader, syntax_tree *root)
+{
+	char const *end = reader->map + reader->len;
+	char const *eol = end;
+	char const *str = next_record(reader->next, end, &eol, &reader->line);
+	if (str == end)
+	{
+		reader->next = end;
+		return 0;
+	}
+	reader->next = eol == end ? end : eol + 1;
+
+	*root = parse_record(&reader->index, &reader->tape, reader->doc, str, eol, reader->flags, 0);
+	if (*root == NULL)
+	{
+		fprintf(stderr, "Error reading record in line %lu\n", reader->line);
+		return -1;
+	}
+	return 1;
+}
+
+void json_ndjson_close(json_ndjson_reader *reader)
+{
+	token_tape_clear(&reader->tape);
+	free(reader->tape.tokens);
+	structural_index_free(&reader->index);
+	json_document_delete(reader->doc);
+	json_unmap_file(reader->map, reader->len);
+}
+
+enum
+{
+	NDJSON_CHUNK = 1 << 20, ///<\brief the minimal number of characters of a parallel chunk
+	NDJSON_AHEAD = 4		///<\brief the number of chunks per thread parsed ahead of the ordered delivery
+};
+
+/**
+ * @brief parsed record waiting for the ordered delivery
+ */
+typedef struct
+{
+	size_t offset;	  ///<\brief the offset of the record in the file
+	syntax_tree root; ///<\brief the root of the record or NULL if malformed
+} ndjson_record;
+
+/**
+ * @brief parsed chunk waiting for the ordered delivery
+ */
+typedef struct
+{
+	json_document *doc;		///<\brief the document holding the trees of the chunk
+	ndjson_record *records; ///<\brief the records of the chunk
+	size_t size;			///<\brief the number of records
+	size_t capacity;		///<\brief the number of allocated record slots
+	int ready;				///<\brief nonzero if the chunk is parsed
+} ndjson_result;
+
+/**
+ * @brief work stealing deque of chunks
+ *
+ * The chunks of worker w are w, w + threads, w + 2 * threads and so on,
+ * the deque holds the sequence positions from head to tail.
+ */
+typedef struct
+{
+	pthread_mutex_t lock; ///<\brief the lock of the deque
+	size_t head;		  ///<\brief the position taken next by the owner
+	size_t tail;		  ///<\brief the position past the chunk stolen next
+} ndjson_deque;
+
+/**
+ * @brief shared state of a parallel read
+ */
+typedef struct
+{
+	char const *map;			 ///<\brief the mapped file
+	unsigned flags;				 ///<\brief bitwise or of LEX_* flags
+	size_t *bounds;				 ///<\brief chunk i spans the characters from bounds[i] to bounds[i + 1]
+	size_t chunks;				 ///<\brief the number of chunks
+	unsigned threads;			 ///<\brief the number of worker threads
+	ndjson_deque *deques;		 ///<\brief the deques of the workers
+	int ordered;				 ///<\brief nonzero for ordered delivery
+	json_ndjson_callback callback; ///<\brief the callback receiving the records
+	void *ctx;					 ///<\brief the context pointer of the callback
+	int stop;					 ///<\brief nonzero if reading is stopped, accessed atomically
+	pthread_mutex_t lock;		 ///<\brief the lock of the ordered delivery
+	pthread_cond_t delivered;	 ///<\brief signaled when a chunk is delivered or reading is stopped
+	ndjson_result *results;		 ///<\brief the parsed chunks of the ordered delivery
+	size_t next;				 ///<\brief the next chunk to deliver
+	int delivering;				 ///<\brief nonzero while a worker is delivering
+	ndjson_result *spares;		 ///<\brief the documents and record arrays of the delivered chunks kept for reuse
+	size_t num_spares;			 ///<\brief the number of kept spares
+} ndjson_engine;
+
+/**
+ * @brief worker thread of a parallel read
+ */
+typedef struct
+{
+	ndjson_engine *engine;	///<\brief the shared state
+	unsigned id;			///<\brief the index of the worker and of its deque
+	pthread_t thread;		///<\brief the thread of the worker
+	structural_index index; ///<\brief the structural index of the current record
+	token_tape tape;		///<\brief the tokens of the current record
+	json_document *doc;		///<\brief the document of unordered records
+} ndjson_worker;
+
+/**
+ * @brief Stop a parallel read and wake the waiting workers
+ *
+ * @param e The shared state
+ */
+static void ndjson_stop(ndjson_engine *e)
+{
+	__atomic_store_n(&e->stop, 1, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&e->lock);
+	pthread_cond_broadcast(&e->delivered);
+	pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * @brief Take the next chunk of a worker
+ *
+ * The own deque is served from the front. Unordered reads steal the chunks of the others from the back,
+ * ordered reads steal the lowest chunk left in any deque, as the chunks far ahead would wait for the delivery.
+ *
+ * @param e The shared state
+ * @param id The index of the worker
+ * @param[out] chunk The taken chunk
+ * @return Nonzero if a chunk was taken, zero if all deques are empty
+ */
+static int ndjson_take(ndjson_engine *e, unsigned id, size_t *chunk)
+{
+	ndjson_deque *d = &e->deques[id];
+	int found = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->head < d->tail)
+	{
+		*chunk = id + d->head++ * e->threads;
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	while (!found && e->ordered)
+	{
+		// the victim is chosen without holding the locks, it is checked again when stealing
+		unsigned victim = id;
+		size_t lowest = e->chunks;
+		for (unsigned i = 1; i < e->threads; i++)
+		{
+			unsigned v = (id + i) % e->threads;
+			d = &e->deques[v];
+			pthread_mutex_lock(&d->lock);
+			if (d->head < d->tail && v + d->head * e->threads < lowest)
+			{
+				lowest = v + d->head * e->threads;
+				victim = v;
+			}
+			pthread_mutex_unlock(&d->lock);
+		}
+		if (victim == id)
+			return 0;
+		d = &e->deques[victim];
+		pthread_mutex_lock(&d->lock);
+		if (d->head < d->tail)
+		{
+			*chunk = victim + d->head++ * e->threads;
+			found = 1;
+		}
+		pthread_mutex_unlock(&d->lock);
+	}
+	for (unsigned i = 1; !found && i < e->threads; i++)
+	{
+		unsigned victim = (id + i) % e->threads;
+		d = &e->deques[victim];
+		pthread_mutex_lock(&d->lock);
+		if (d->head < d->tail)
+		{
+			*chunk = victim + --d->tail * e->threads;
+			found = 1;
+		}
+		pthread_mutex_unlock(&d->lock);
+	}
+	return found;
+}
+
+/**
+ * @brief Parse a chunk and deliver its records at once
+ *
+ * @param w The worker
+ * @param chunk The chunk
+ * @return 0 on success, -1 if the callback stopped reading
+ */
+static int ndjson_chunk_unordered(ndjson_worker *w, size_t chunk)
+{
+	ndjson_engine *e = w->engine;
+	char const *end = e->map + e->bounds[chunk + 1];
+	char const *eol = end;
+	size_t line = 0;
+	for (char const *str = e->map + e->bounds[chunk]; (str = next_record(str, end, &eol, &line)) != end;
+		 str = eol == end ? end : eol + 1)
+	{
+		// a callback may have stopped the read in another worker
+		if (__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE))
+			return -1;
+		syntax_tree root = parse_record(&w->index, &w->tape, w->doc, str, eol, e->flags, 0);
+		if (e->callback(e->ctx, str - e->map, root) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Deliver the parsed chunks in file order
+ *
+ * Called with the delivery lock held, the lock is released while the callbacks run.
+ *
+ * @param e The shared state
+ */
+static void ndjson_deliver(ndjson_engine *e)
+{
+	e->delivering = 1;
+	while (!__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE) && e->next < e->chunks && e->results[e->next].ready)
+	{
+		ndjson_result *r = &e->results[e->next];
+		pthread_mutex_unlock(&e->lock);
+		int stop = 0;
+		for (size_t i = 0; !stop && i < r->size; i++)
+			stop = e->callback(e->ctx, r->records[i].offset, r->records[i].root) != 0;
+		json_document_reset(r->doc);
+		if (stop)
+			__atomic_store_n(&e->stop, 1, __ATOMIC_RELEASE);
+		pthread_mutex_lock(&e->lock);
+		// the document and the record array are reused by a later chunk
+		ndjson_result *spare = &e->spares[e->num_spares++];
+		spare->doc = r->doc;
+		spare->records = r->records;
+		spare->capacity = r->capacity;
+		r->doc = NULL;
+		r->records = NULL;
+		r->capacity = 0;
+		e->next++;
+		pthread_cond_broadcast(&e->delivered);
+	}
+	e->delivering = 0;
+}
+
+/**
+ * @brief Parse a chunk into a document of its own and deliver the chunks in order
+ *
+ * @param w The worker
+ * @param chunk The chunk
+ * @return 0 on success, -1 if reading is stopped or could not allocate
+ */
+static int ndjson_chunk_ordered(ndjson_worker *w, size_t chunk)
+{
+	ndjson_engine *e = w->engine;
+	ndjson_result *r = &e->results[chunk];
+
+	// bound the chunks parsed ahead of the delivery
+	pthread_mutex_lock(&e->lock);
+	while (!__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE) && chunk >= e->next + NDJSON_AHEAD * e->threads)
+		pthread_cond_wait(&e->delivered, &e->lock);
+	if (e->num_spares > 0)
+	{
+		ndjson_result *spare = &e->spares[--e->num_spares];
+		r->doc = spare->doc;
+		r->records = spare->records;
+		r->capacity = spare->capacity;
+	}
+	pthread_mutex_unlock(&e->lock);
+	if (r->doc == NULL)
+		r->doc = json_document_create();
+	if (r->doc == NULL || __atomic_load_n(&e->stop, __ATOMIC_ACQUIRE))
+		return -1;
+
+	char const *end = e->map + e->bounds[chunk + 1];
+	char const *eol = end;
+	size_t line = 0;
+	for (char const *str = e->map + e->bounds[chunk]; (str = next_record(str, end, &eol, &line)) != end;
+		 str = eol == end ? end : eol + 1)
+	{
+		if (r->size == r->capacity)
+		{
+			size_t capacity = r->capacity == 0 ? 256 : 2 * r->capacity;
+			ndjson_record *records = realloc(r->records, capacity * sizeof(ndjson_record));
+			if (records == NULL)
+				return -1;
+			r->records = records;
+			r->capacity = capacity;
+		}
+		r->records[r->size].offset = str - e->map;
+		r->records[r->size++].root = parse_record(&w->index, &w->tape, r->doc, str, eol, e->flags, 1);
+	}
+
+	pthread_mutex_lock(&e->lock);
+	r->ready = 1;
+	if (!e->delivering)
+		ndjson_deliver(e);
+	pthread_mutex_unlock(&e->lock);
+	return 0;
+}
+
+/**
+ * @brief Run a worker thread
+ *
+ * @param arg The worker
+ * @return NULL
+ */
+static void *ndjson_work(void *arg)
+{
+	ndjson_worker *w = arg;
+	ndjson_engine *e = w->engine;
+	size_t chunk;
+	while (!__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE) && ndjson_take(e, w->id, &chunk))
+	{
+		int ret = e->ordered ? ndjson_chunk_ordered(w, chunk) : ndjson_chunk_unordered(w, chunk);
+		if (ret != 0)
+			ndjson_stop(e);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Split a file into chunks ending at new lines
+ *
+ * @param e The shared state, the chunk bounds are set
+ * @param len The number of characters of the file
+ * @return 0 on success, -1 if could not allocate
+ */
+static int ndjson_split(ndjson_engine *e, size_t len)
+{
+	e->bounds = malloc((len / NDJSON_CHUNK + 2) * sizeof(size_t));
+	if (e->bounds == NULL)
+		return -1;
+	e->chunks = 0;
+	e->bounds[0] = 0;
+	size_t pos = 0;
+	while (pos < len)
+	{
+		char const *nl = len - pos > NDJSON_CHUNK ? memchr(e->map + pos + NDJSON_CHUNK, '\n', len - pos - NDJSON_CHUNK) : NULL;
+		pos = nl != NULL ? (size_t)(nl - e->map) + 1 : len;
+		e->bounds[++e->chunks] = pos;
+	}
+	return 0;
+}
+
+/**
+ * @brief Run the workers of a parallel read
+ *
+ * @param e The initialized shared state
+ * @param workers The workers
+ * @return 0 on success, -1 if could not start the threads or reading was stopped
+ */
+static int ndjson_run(ndjson_engine *e, ndjson_worker *workers)
+{
+	unsigned started = 0;
+	int ret = 0;
+	for (unsigned i = 0; i < e->threads; i++)
+	{
+		ndjson_worker *w = &workers[i];
+		w->engine = e;
+		w->id = i;
+		structural_index_init(&w->index);
+		w->tape.tokens = NULL;
+		w->tape.size = w->tape.capacity = 0;
+		w->doc = json_document_create();
+		if (w->doc == NULL || pthread_create(&w->thread, NULL, ndjson_work, w) != 0)
+		{
+			json_document_delete(w->doc);
+			ndjson_stop(e);
+			ret = -1;
+			break;
+		}
+		started++;
+	}
+	for (unsigned i = 0; i < started; i++)
+	{
+		ndjson_worker *w = &workers[i];
+		pthread_join(w->thread, NULL);
+		token_tape_clear(&w->tape);
+		free(w->tape.tokens);
+		structural_index_free(&w->index);
+		json_document_delete(w->doc);
+	}
+	if (__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE))
+		ret = -1;
+	return ret;
+}
+
+int json_ndjson_parallel(char const *path, unsigned flags, unsigned threads, int ordered,
+						 json_ndjson_callback callback, void *ctx)
+{
+	if (threads == 0)
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = n > 0 ? (unsigned)n : 1;
+	}
+	size_t len;
+	ndjson_engine e;
+	e.map = json_map_file(path, &len);
+	if (e.map == NULL)
+		return -1;
+	if (len == 0)
+	{
+		// an empty file has no records
+		json_unmap_file(e.map, len);
+		return 0;
+	}
+	e.flags = flags;
+	e.threads = threads;
+	e.ordered = ordered;
+	e.callback = callback;
+	e.ctx = ctx;
+	e.stop = 0;
+	e.next = 0;
+	e.delivering = 0;
+	e.num_spares = 0;
+	pthread_mutex_init(&e.lock, NULL);
+	pthread_cond_init(&e.delivered, NULL);
+
+	int ret = -1;
+	e.deques = NULL;
+	e.results = NULL;
+	e.spares = NULL;
+	ndjson_worker *workers = malloc(threads * sizeof(ndjson_worker));
+	if (workers != NULL && ndjson_split(&e, len) == 0)
+	{
+		e.deques = malloc(threads * sizeof(ndjson_deque));
+		e.results = calloc(e.chunks, sizeof(ndjson_result));
+		e.spares = malloc((NDJSON_AHEAD + 1) * threads * sizeof(ndjson_result));
+		if (e.deques != NULL && e.results != NULL && e.spares != NULL)
+		{
+			// the chunks are dealt round robin
+			for (unsigned i = 0; i < threads; i++)
+			{
+				pthread_mutex_init(&e.deques[i].lock, NULL);
+				e.deques[i].head = 0;
+				e.deques[i].tail = i < e.chunks ? (e.chunks - i + threads - 1) / threads : 0;
+			}
+			ret = ndjson_run(&e, workers);
+			for (unsigned i = 0; i < threads; i++)
+				pthread_mutex_destroy(&e.deques[i].lock);
+		}
+		free(e.bounds);
+	}
+
+	// chunks left undelivered by a stop
+	for (size_t i = 0; e.results != NULL && i < e.chunks; i++)
+	{
+		json_document_delete(e.results[i].doc);
+		free(e.results[i].records);
+	}
+	while (e.num_spares > 0)
+	{
+		e.num_spares--;
+		json_document_delete(e.spares[e.num_spares].doc);
+		free(e.spares[e.num_spares].records);
+	}
+	free(e.results);
+	free(e.spares);
+	free(e.deques);
+	free(workers);
+	pthread_cond_destroy(&e.delivered);
+	pthread_mutex_destroy(&e.lock);
+	json_unmap_file(e.map, len);
+	return ret;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file ndjson_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief reader of newline delimited JSON files
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef NDJSON_JSON_H_INCLUDED
+#define NDJSON_JSON_H_INCLUDED
+
+#include "parse_json.h"
+
+/**
+ * @brief reader of the records of a newline delimited JSON file
+ *
+ * Each line of the file is a record holding one array or object, empty lines are skipped.
+ * The file is memory mapped, the structural index, the token tape and the document
+ * are reused by all records, so reading a record allocates nothing once the
+ * storage has grown to the largest record.
+ */
+typedef struct
+{
+	char const *map;		///<\brief the mapped file
+	size_t len;				///<\brief the number of mapped characters
+	char const *next;		///<\brief the first character of the next record
+	unsigned flags;			///<\brief bitwise or of LEX_* flags
+	size_t line;			///<\brief the line number of the last record
+	structural_index index; ///<\brief the structural index of the current record
+	token_tape tape;		///<\brief the tokens of the current record
+	json_document *doc;		///<\brief the document of the current record
+} json_ndjson_reader;
+
+/**
+ * @brief Open a newline delimited JSON file
+ *
+ * @param reader The reader
+ * @param path The path of the file
+ * @param flags Bitwise or of LEX_* flags, the trees may refer to the mapped file until the reader is closed
+ * @return 0 on success, -1 if the file could not be mapped or could not allocate
+ */
+int json_ndjson_open(json_ndjson_reader *reader, char const *path, unsigned flags);
+
+/**
+ * @brief Read the next record
+ *
+ * The tree of the previous record is released. A malformed record is reported
+ * with its line number, the reader continues with the next line at the next call.
+ *
+ * @param reader The reader
+ * @param[out] root The root of the syntax tree of the record, owned by the reader
+ * @return 1 if a record was read, 0 at the end of the file, -1 if the record could not be read or interpreted
+ */
+int json_ndjson_next(json_ndjson_reader *reader, syntax_tree *root);
+
+/**
+ * @brief Close a newline delimited JSON file and release the storage of the reader
+ *
+ * @param reader The reader
+ */
+void json_ndjson_close(json_ndjson_reader *reader);
+
+/**
+ * @brief Callback receiving the records of a parallel read
+ * 
+ * @param ctx The context pointer passed to json_ndjson_parallel
+ * @param offset The offset of the first character of the record in the file
+ * @param root The root of the syntax tree of the record or NULL if the record is malformed,
+ * the tree is released after the callback returns
+ * @return 0 to continue, nonzero to stop reading
+ */
+typedef int (*json_ndjson_callback)(void *ctx, size_t offset, syntax_tree root);
+
+/**
+ * @brief Read the records of a newline delimited JSON file on several threads
+ * 
+ * The mapped file is split into chunks ending at new lines. The chunks are dealt to the
+ * deques of the worker threads, a worker takes its chunks from the front of its deque
+ * and steals from the other deques when its own is empty, from the back for unordered reads
+ * and the lowest chunk left for ordered reads. Each worker parses
+ * into its own documents, structural index and token tape.
+ * 
+ * Unordered callbacks are called concurrently from the worker threads as soon as a record is parsed.
+ * Ordered callbacks are called one at a time in file order: a chunk is parsed into a document
+ * of its own and delivered when the chunks before it are delivered, the number of chunks parsed
+ * ahead of the delivery is bounded.
+ * 
+ * @param path The path of the file
+ * @param flags Bitwise or of LEX_* flags
+ * @param threads The number of worker threads or 0 for one per online processor
+ * @param ordered Nonzero to deliver the records in file order
+ * @param callback The callback receiving the records
+ * @param ctx The context pointer passed to the callback
+ * @return 0 on success, -1 if the file could not be mapped, could not allocate or start the threads, or the callback stopped reading
+ */
+int json_ndjson_parallel(char const *path, unsigned flags, unsigned threads, int ordered,
+						 json_ndjson_callback callback, void *ctx);
+
+#endif // NDJSON_JSON_H_INCLUDED
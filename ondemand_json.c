@@ -0,0 +1,383 @@
+/**
+ * @file ondemand_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the on demand navigation
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "ondemand_json.h"
+
+#include <string.h>
+
+void json_ondemand_init(json_ondemand_doc *doc)
+{
+	doc->buf = NULL;
+	doc->len = 0;
+	doc->flags = 0;
+	structural_index_init(&doc->index);
+}
+
+int json_ondemand_parse(json_ondemand_doc *doc, char const *buf, size_t len, unsigned flags)
+{
+	doc->buf = buf;
+	doc->len = len;
+	doc->flags = flags;
+	if (structural_index_build(&doc->index, buf, len) != 0)
+	{
+		doc->index.size = 0;
+		return -1;
+	}
+	return doc->index.size > 0 ? 0 : -1;
+}
+
+void json_ondemand_free(json_ondemand_doc *doc)
+{
+	structural_index_free(&doc->index);
+	json_ondemand_init(doc);
+}
+
+/**
+ * @brief Get the character at a structural position
+ *
+ * @param doc The document
+ * @param pos The structural position
+ * @return The character or '\0' past the last structural position
+ */
+static char structural_char(json_ondemand_doc const *doc, size_t pos)
+{
+	return pos < doc->index.size ? doc->buf[doc->index.positions[pos]] : '\0';
+}
+
+/**
+ * @brief Check if a structural character can start a value
+ *
+ * @param c The structural character
+ * @return Nonzero if the character starts a value
+ */
+static int starts_value(char c)
+{
+	switch (c)
+	{
+	case '\0':
+	case ',':
+	case ':':
+	case ']':
+	case '}':
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+/**
+ * @brief Skip a value by bracket matching
+ *
+ * The tokens of the skipped value are not read.
+ *
+ * @param doc The document
+ * @param pos The structural position of the value
+ * @return The structural position after the value or 0 if the brackets are not balanced
+ */
+static size_t skip_value(json_ondemand_doc const *doc, size_t pos)
+{
+	size_t depth = 0;
+	for (; pos < doc->index.size; pos++)
+	{
+		switch (doc->buf[doc->index.positions[pos]])
+		{
+		case '[':
+		case '{':
+			depth++;
+			break;
+		case ']':
+		case '}':
+			if (depth == 0)
+				return 0;
+			depth--;
+			break;
+		default:
+			break;
+		}
+		if (depth == 0)
+			return pos + 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Read the token starting a value
+ *
+ * @param value The value
+ * @param flags Bitwise or of LEX_* flags
+ * @param[out] tok The token
+ * @return 0 on success, -1 if could not read a token
+ */
+static int read_value_token(json_ondemand_value const *value, unsigned flags, token_t *tok)
+{
+	json_ondemand_doc const *doc = value->doc;
+	if (value->pos >= doc->index.size)
+		return -1;
+	size_t offset = doc->index.positions[value->pos];
+	json_lexer lexer;
+	json_lexer_init(&lexer, doc->buf + offset, doc->len - offset, flags);
+	return json_lexer_next(&lexer, tok) == 1 ? 0 : -1;
+}
+
+/**
+ * @brief Compare an object key with a field name
+ *
+ * Keys without escapes are compared in the buffer, the others are decoded first.
+ *
+ * @param doc The document
+ * @param pos The structural position of the key, it is followed by a colon
+ * @param fieldname The field name
+ * @param len The length of the field name
+ * @return 1 if the key is the field name, 0 if not, -1 if the key is malformed
+ */
+static int key_matches(json_ondemand_doc const *doc, size_t pos, char const *fieldname, size_t len)
+{
+	char const *body = doc->buf + doc->index.positions[pos] + 1;
+	char const *e = doc->buf + doc->index.positions[pos + 1];
+	// the closing quote is the last character before the colon
+	while (e != body && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n' || e[-1] == '\r'))
+		e--;
+	if (e == body || e[-1] != '"')
+		return -1;
+	e--;
+	if (memchr(body, '\\', e - body) == NULL)
+		return (size_t)(e - body) == len && memcmp(body, fieldname, len) == 0;
+
+	json_ondemand_value key = {doc, pos};
+	token_t tok;
+	if (json_ondemand_get_string(&key, &tok) != 0)
+		return -1;
+	int match = tok.value.string.len == len && memcmp(tok.value.string.ptr, fieldname, len) == 0;
+	token_free(&tok);
+	return match;
+}
+
+void json_ondemand_root(json_ondemand_doc const *doc, json_ondemand_value *root)
+{
+	root->doc = doc;
+	root->pos = 0;
+}
+
+token_type_t json_ondemand_type(json_ondemand_value const *value)
+{
+	switch (structural_char(value->doc, value->pos))
+	{
+	case '[':
+		return TOKEN_BRACKET_ARRAY_OPEN;
+	case '{':
+		return TOKEN_BRACKET_OBJECT_OPEN;
+	case ']':
+		return TOKEN_BRACKET_ARRAY_CLOSE;
+	case '}':
+		return TOKEN_BRACKET_OBJECT_CLOSE;
+	case ':':
+		return TOKEN_PUNCTUATOR_COLON;
+	case ',':
+		return TOKEN_PUNCTUATOR_COMMA;
+	case '"':
+		return TOKEN_STRING;
+	case 't':
+		return TOKEN_TRUE;
+	case 'f':
+		return TOKEN_FALSE;
+	case 'n':
+		return TOKEN_NULL;
+	default:
+		return TOKEN_NUMBER;
+	}
+}
+
+int json_ondemand_iter_init(json_ondemand_value const *container, json_ondemand_iter *it)
+{
+	char c = structural_char(container->doc, container->pos);
+	if (c != '[' && c != '{')
+		return -1;
+	it->doc = container->doc;
+	it->pos = container->pos + 1;
+	it->object = c == '{';
+	return 0;
+}
+
+int json_ondemand_iter_next(json_ondemand_iter *it, json_ondemand_value *key, json_ondemand_value *value)
+{
+	json_ondemand_doc const *doc = it->doc;
+	char close = it->object ? '}' : ']';
+	size_t pos = it->pos;
+	if (structural_char(doc, pos) == close)
+		return 0;
+	if (it->object)
+	{
+		if (structural_char(doc, pos) != '"' || structural_char(doc, pos + 1) != ':')
+			return -1;
+		if (key != NULL)
+		{
+			key->doc = doc;
+			key->pos = pos;
+		}
+		pos += 2;
+	}
+	if (!starts_value(structural_char(doc, pos)))
+		return -1;
+	size_t next = skip_value(doc, pos);
+	if (next == 0)
+		return -1;
+	// a comma must be followed by another child
+	char c = structural_char(doc, next);
+	if (c == ',' && structural_char(doc, next + 1) != close)
+		next++;
+	else if (c != close)
+		return -1;
+	value->doc = doc;
+	value->pos = pos;
+	it->pos = next;
+	return 1;
+}
+
+int json_ondemand_get_field(json_ondemand_value const *object, char const *fieldname, json_ondemand_value *value)
+{
+	json_ondemand_iter it;
+	if (structural_char(object->doc, object->pos) != '{' || json_ondemand_iter_init(object, &it) != 0)
+		return -1;
+	size_t len = strlen(fieldname);
+	json_ondemand_value key;
+	while (json_ondemand_iter_next(&it, &key, value) == 1)
+	{
+		int match = key_matches(object->doc, key.pos, fieldname, len);
+		if (match != 0)
+			return match == 1 ? 0 : -1;
+	}
+	return -1;
+}
+
+int json_ondemand_at(json_ondemand_value const *array, size_t i, json_ondemand_value *value)
+{
+	json_ondemand_iter it;
+	if (structural_char(array->doc, array->pos) != '[' || json_ondemand_iter_init(array, &it) != 0)
+		return -1;
+	for (size_t n = 0; json_ondemand_iter_next(&it, NULL, value) == 1; n++)
+	{
+		if (n == i)
+			return 0;
+	}
+	return -1;
+}
+
+int json_ondemand_get_string(json_ondemand_value const *value, token_t *tok)
+{
+	if (structural_char(value->doc, value->pos) != '"')
+		return -1;
+	return read_value_token(value, value->doc->flags & LEX_ZERO_COPY, tok);
+}
+
+/**
+ * @brief Read a converted number token
+ *
+ * @param value The value
+ * @param[out] tok The number token
+ * @return 0 on success, -1 if the value is not a number
+ */
+static int read_number_token(json_ondemand_value const *value, token_t *tok)
+{
+	switch (json_ondemand_type(value))
+	{
+	case TOKEN_NUMBER:
+		return read_value_token(value, 0, tok);
+	default:
+		return -1;
+	}
+}
+
+int json_ondemand_get_double(json_ondemand_value const *value, double *number)
+{
+	token_t tok;
+	if (read_number_token(value, &tok) != 0)
+		return -1;
+	switch (tok.type)
+	{
+	case TOKEN_INTEGER:
+		*number = (double)tok.value.integer;
+		return 0;
+	case TOKEN_UNSIGNED:
+		*number = (double)tok.value.uinteger;
+		return 0;
+	default:
+		*number = tok.value.number;
+		return 0;
+	}
+}
+
+int json_ondemand_get_int64(json_ondemand_value const *value, int64_t *number)
+{
+	token_t tok;
+	if (read_number_token(value, &tok) != 0)
+		return -1;
+	switch (tok.type)
+	{
+	case TOKEN_INTEGER:
+		*number = tok.value.integer;
+		return 0;
+	case TOKEN_NUMBER:
+		// the range limits are powers of two, so they are exact doubles
+		if (!(tok.value.number >= -0x1p63 && tok.value.number < 0x1p63) ||
+			tok.value.number != (double)(int64_t)tok.value.number)
+			return -1;
+		*number = (int64_t)tok.value.number;
+		return 0;
+	default:
+		// unsigned numbers are always above INT64_MAX
+		return -1;
+	}
+}
+
+int json_ondemand_get_uint64(json_ondemand_value const *value, uint64_t *number)
+{
+	token_t tok;
+	if (read_number_token(value, &tok) != 0)
+		return -1;
+	switch (tok.type)
+	{
+	case TOKEN_UNSIGNED:
+		*number = tok.value.uinteger;
+		return 0;
+	case TOKEN_INTEGER:
+		if (tok.value.integer < 0)
+			return -1;
+		*number = (uint64_t)tok.value.integer;
+		return 0;
+	default:
+		if (!(tok.value.number >= 0.0 && tok.value.number < 0x1p64) ||
+			tok.value.number != (double)(uint64_t)tok.value.number)
+			return -1;
+		*number = (uint64_t)tok.value.number;
+		return 0;
+	}
+}
+
+int json_ondemand_get_bool(json_ondemand_value const *value, int *b)
+{
+	token_t tok;
+	switch (json_ondemand_type(value))
+	{
+	case TOKEN_TRUE:
+	case TOKEN_FALSE:
+		if (read_value_token(value, 0, &tok) != 0)
+			return -1;
+		*b = tok.type == TOKEN_TRUE;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+int json_ondemand_is_null(json_ondemand_value const *value)
+{
+	token_t tok;
+	return json_ondemand_type(value) == TOKEN_NULL && read_value_token(value, 0, &tok) == 0;
+}
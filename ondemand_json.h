@@ -0,0 +1,199 @@
+/**
+ * @file ondemand_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief on demand navigation of JSON documents over the structural index
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef ONDEMAND_JSON_H_INCLUDED
+#define ONDEMAND_JSON_H_INCLUDED
+
+#include "lex_json.h"
+#include <stdint.h>
+
+/**
+ * @brief JSON document navigated on demand
+ *
+ * Parsing a document only builds the structural index of the buffer. Values are
+ * addressed by their structural position and are read only when the caller asks for them,
+ * skipped containers are jumped over by bracket matching without reading their tokens.
+ * The parts of the document that are never visited are not validated.
+ */
+typedef struct
+{
+	char const *buf;		///<\brief the input buffer
+	size_t len;				///<\brief the number of characters in the buffer
+	unsigned flags;			///<\brief bitwise or of LEX_* flags used when reading strings
+	structural_index index; ///<\brief the structural index of the buffer
+} json_ondemand_doc;
+
+/**
+ * @brief value of an on demand document
+ */
+typedef struct
+{
+	json_ondemand_doc const *doc; ///<\brief the document of the value
+	size_t pos;					  ///<\brief the structural position of the first token of the value
+} json_ondemand_value;
+
+/**
+ * @brief iterator over the children of an array or an object
+ */
+typedef struct
+{
+	json_ondemand_doc const *doc; ///<\brief the document of the container
+	size_t pos;					  ///<\brief the structural position of the next child or of the closing bracket
+	int object;					  ///<\brief nonzero if the container is an object
+} json_ondemand_iter;
+
+/**
+ * @brief Initialize an empty on demand document
+ *
+ * @param doc The document
+ */
+void json_ondemand_init(json_ondemand_doc *doc);
+
+/**
+ * @brief Index a character buffer for on demand navigation
+ *
+ * The storage of the document is reused, the buffer must outlive the values read from it.
+ *
+ * @param doc The document
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags, LEX_ZERO_COPY makes strings without escapes views into the buffer
+ * @return 0 on success, -1 if the buffer could not be indexed or is empty
+ */
+int json_ondemand_parse(json_ondemand_doc *doc, char const *buf, size_t len, unsigned flags);
+
+/**
+ * @brief Release the storage of an on demand document
+ *
+ * @param doc The document
+ */
+void json_ondemand_free(json_ondemand_doc *doc);
+
+/**
+ * @brief Get the root value of a document
+ *
+ * @param doc The parsed document
+ * @param[out] root The root value
+ */
+void json_ondemand_root(json_ondemand_doc const *doc, json_ondemand_value *root);
+
+/**
+ * @brief Get the type of a value
+ *
+ * The type is decided by the first character of the value, numbers are reported as TOKEN_NUMBER.
+ *
+ * @param value The value
+ * @return TOKEN_BRACKET_ARRAY_OPEN for arrays, TOKEN_BRACKET_OBJECT_OPEN for objects or the scalar token type
+ */
+token_type_t json_ondemand_type(json_ondemand_value const *value);
+
+/**
+ * @brief Get a specific field of an object
+ *
+ * The fields before the searched one are skipped without reading their values.
+ *
+ * @param object The object value
+ * @param fieldname The searched field name
+ * @param[out] value The value of the field
+ * @return 0 on success, -1 if the value is not an object, the field does not exist or the object is malformed
+ */
+int json_ondemand_get_field(json_ondemand_value const *object, char const *fieldname, json_ondemand_value *value);
+
+/**
+ * @brief Get an element of an array
+ *
+ * The elements before the searched one are skipped without reading them.
+ *
+ * @param array The array value
+ * @param i The index of the element
+ * @param[out] value The element
+ * @return 0 on success, -1 if the value is not an array, the index is out of range or the array is malformed
+ */
+int json_ondemand_at(json_ondemand_value const *array, size_t i, json_ondemand_value *value);
+
+/**
+ * @brief Start iterating over the children of a container
+ *
+ * @param container The array or object value
+ * @param[out] it The iterator
+ * @return 0 on success, -1 if the value is not a container
+ */
+int json_ondemand_iter_init(json_ondemand_value const *container, json_ondemand_iter *it);
+
+/**
+ * @brief Get the next child of a container
+ *
+ * @param it The iterator
+ * @param[out] key The key of the field for objects, may be NULL
+ * @param[out] value The next element or field value
+ * @return 1 if a child was found, 0 at the end of the container, -1 if the container is malformed
+ */
+int json_ondemand_iter_next(json_ondemand_iter *it, json_ondemand_value *key, json_ondemand_value *value);
+
+/**
+ * @brief Get the body of a string value
+ *
+ * The dynamically allocated string body of the token is owned by the caller,
+ * it is released with token_free.
+ *
+ * @param value The string value or object key
+ * @param[out] tok The string token
+ * @return 0 on success, -1 if the value is not a string
+ */
+int json_ondemand_get_string(json_ondemand_value const *value, token_t *tok);
+
+/**
+ * @brief Get the value of a number as a double
+ *
+ * Integers are converted to the nearest double.
+ *
+ * @param value The value
+ * @param[out] number The number value
+ * @return 0 on success, -1 if the value is not a number
+ */
+int json_ondemand_get_double(json_ondemand_value const *value, double *number);
+
+/**
+ * @brief Get the value of a number as a signed 64 bit integer
+ *
+ * @param value The value
+ * @param[out] number The number value
+ * @return 0 on success, -1 if the value is not a number or not an integer in the range of int64_t
+ */
+int json_ondemand_get_int64(json_ondemand_value const *value, int64_t *number);
+
+/**
+ * @brief Get the value of a number as an unsigned 64 bit integer
+ *
+ * @param value The value
+ * @param[out] number The number value
+ * @return 0 on success, -1 if the value is not a number or not an integer in the range of uint64_t
+ */
+int json_ondemand_get_uint64(json_ondemand_value const *value, uint64_t *number);
+
+/**
+ * @brief Get the value of a boolean
+ *
+ * @param value The value
+ * @param[out] b 1 for true, 0 for false
+ * @return 0 on success, -1 if the value is not a boolean
+ */
+int json_ondemand_get_bool(json_ondemand_value const *value, int *b);
+
+/**
+ * @brief Check if a value is null
+ *
+ * @param value The value
+ * @return Nonzero if the value is null
+ */
+int json_ondemand_is_null(json_ondemand_value const *value);
+
+#endif // ONDEMAND_JSON_H_INCLUDED
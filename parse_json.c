@@ -9,67 +9,384 @@
  * 
  */
 #include "parse_json.h"
+#include "hash_json.h"
 
+#include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * @brief Clone a string by making a dynamic zero terminated copy
+ * 
+ * @param str The input string
+ * @return The cloned string
+ */
+static json_string strclone(json_string str)
+{
+	char *s = malloc(str.len + 1);
+	memcpy(s, str.ptr, str.len);
+	s[str.len] = '\0';
+	str.ptr = s;
+	return str;
+}
+
+/**
+ * @brief Allocate tree memory from an arena or from the heap
+ * 
+ * @param arena The document arena or NULL for heap allocation
+ * @param size The number of bytes
+ * @return Pointer to the allocated memory or NULL if could not allocate
+ */
+static void *tree_alloc(json_arena *arena, size_t size)
+{
+	return arena != NULL ? json_arena_alloc(arena, size) : malloc(size);
+}
+
 /**
  * @brief Create a new syntax tree node
  * 
+ * @param arena The document arena or NULL for heap allocation
  * @param type The node identifier 
- * @param data The generic data, NULL if none
  * @return A newly allocated syntax tree node with no children
  */
-static syntax_tree syntax_tree_node_create(syntax_type_t type, void *data)
+static syntax_tree syntax_tree_node_create(json_arena *arena, syntax_type_t type)
 {
-	syntax_tree t = malloc(sizeof(syntax_tree_elem));
+	syntax_tree t = tree_alloc(arena, sizeof(syntax_tree_elem));
 	if (t == NULL)
 		return NULL;
 	t->type = type;
-	t->data = data;
+	t->flags = arena != NULL ? SYNTAX_FLAG_ARENA : 0;
+	memset(&t->data, 0, sizeof(t->data));
 	t->children = NULL;
+	t->num_children = 0;
+	t->capacity = 0;
 	return t;
 }
 
 /**
- * @brief Returns the number of child nodes of a syntax tree node
+ * @brief Create a new string node from a string token
  * 
- * @param tree Pointer to the tree node
- * @return The number of children nodes
+ * A dynamically allocated string body is copied into the arena
+ * or moved from the token into the heap allocated node.
+ * 
+ * @param arena The document arena or NULL for heap allocation
+ * @param tok The string token
+ * @return A newly allocated string node
+ */
+static syntax_tree syntax_tree_string_create(json_arena *arena, token_t *tok)
+{
+	syntax_tree t = syntax_tree_node_create(arena, syntax_string);
+	if (t == NULL)
+		return NULL;
+	t->data.string = tok->value.string;
+	if (!(tok->flags & TOKEN_FLAG_OWNED))
+		return t;
+	if (arena != NULL)
+	{
+		char *s = json_arena_alloc(arena, tok->value.string.len + 1);
+		if (s == NULL)
+			return NULL;
+		memcpy(s, tok->value.string.ptr, tok->value.string.len);
+		s[tok->value.string.len] = '\0';
+		t->data.string.ptr = s;
+	}
+	else
+	{
+		t->flags |= SYNTAX_FLAG_OWNED;
+		tok->flags &= ~TOKEN_FLAG_OWNED;
+	}
+	return t;
+}
+
+/**
+ * @brief string interned in a key or value pool of a document
  */
-static size_t syntax_tree_num_children(syntax_tree tree)
+struct json_intern_entry
 {
-	size_t i = 0;
-	for (syntax_tree *c = tree->children; c != NULL && *c != NULL; c++)
-		i++;
+	uint64_t hash; ///<\brief the hash of the string
+	size_t id;	   ///<\brief the dense identifier of the string in its pool
+	size_t len;	   ///<\brief the number of characters
+	char str[];	   ///<\brief the zero terminated characters
+};
+
+/**
+ * @brief Get the pool entry of an interned string
+ * 
+ * @param str The body of an interned string
+ * @return Pointer to the pool entry
+ */
+static struct json_intern_entry const *intern_entry(char const *str)
+{
+	return (struct json_intern_entry const *)(str - offsetof(struct json_intern_entry, str));
+}
+
+/**
+ * @brief Find the slot of a string in a non-empty pool
+ * 
+ * @param pool The string pool
+ * @param hash The hash of the string
+ * @param str The characters of the string
+ * @param len The number of characters
+ * @return The index of the slot holding the string or of the empty slot ending the probe sequence
+ */
+static size_t intern_find(json_intern_pool const *pool, uint64_t hash, char const *str, size_t len)
+{
+	size_t mask = pool->capacity - 1;
+	size_t i = (size_t)hash & mask;
+	// linear probing
+	for (; pool->slots[i] != NULL; i = (i + 1) & mask)
+	{
+		struct json_intern_entry const *e = pool->slots[i];
+		if (e->hash == hash && e->len == len && memcmp(e->str, str, len) == 0)
+			break;
+	}
 	return i;
 }
 
+/**
+ * @brief Double the hash table of a string pool
+ * 
+ * @param pool The string pool
+ * @return 0 on success, -1 if could not allocate
+ */
+static int intern_grow(json_intern_pool *pool)
+{
+	size_t capacity = pool->capacity == 0 ? 64 : 2 * pool->capacity;
+	struct json_intern_entry **slots = calloc(capacity, sizeof(struct json_intern_entry *));
+	if (slots == NULL)
+		return -1;
+	for (size_t j = 0; j < pool->capacity; j++)
+	{
+		if (pool->slots[j] == NULL)
+			continue;
+		size_t i = (size_t)pool->slots[j]->hash & (capacity - 1);
+		while (slots[i] != NULL)
+			i = (i + 1) & (capacity - 1);
+		slots[i] = pool->slots[j];
+	}
+	free(pool->slots);
+	pool->slots = slots;
+	pool->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief Intern a string
+ * 
+ * New strings get the next identifier of the pool.
+ * 
+ * @param pool The string pool
+ * @param arena The arena of the interned strings
+ * @param key The body of the string
+ * @return The zero terminated interned body or NULL if could not allocate
+ */
+static char const *intern_string(json_intern_pool *pool, json_arena *arena, json_string key)
+{
+	// the load factor is kept at most one half
+	if (2 * (pool->size + 1) > pool->capacity && intern_grow(pool) != 0)
+		return NULL;
+	uint64_t hash = json_hash(key.ptr, key.len);
+	size_t i = intern_find(pool, hash, key.ptr, key.len);
+	if (pool->slots[i] == NULL)
+	{
+		struct json_intern_entry *e = json_arena_alloc(arena, sizeof(struct json_intern_entry) + key.len + 1);
+		if (e == NULL)
+			return NULL;
+		e->hash = hash;
+		e->id = pool->size;
+		e->len = key.len;
+		memcpy(e->str, key.ptr, key.len);
+		e->str[key.len] = '\0';
+		pool->slots[i] = e;
+		pool->size++;
+	}
+	return pool->slots[i]->str;
+}
+
+/**
+ * @brief Remove all strings from a pool and keep its hash table
+ * 
+ * @param pool The string pool
+ */
+static void intern_clear(json_intern_pool *pool)
+{
+	if (pool->size > 0)
+		memset(pool->slots, 0, pool->capacity * sizeof(struct json_intern_entry *));
+	pool->size = 0;
+}
+
+int syntax_tree_get_string_id(syntax_tree node, size_t *id)
+{
+	if (node == NULL || node->type != syntax_string || !(node->flags & SYNTAX_FLAG_DICT))
+		return -1;
+	*id = intern_entry(node->data.string.ptr)->id;
+	return 0;
+}
+
+size_t syntax_tree_num_children(syntax_tree tree)
+{
+	return tree->num_children;
+}
+
+/**
+ * @brief frame of a tree walk
+ */
+typedef struct
+{
+	syntax_tree node; ///<\brief the visited node
+	syntax_tree copy; ///<\brief the copy of the visited node
+	size_t next;	  ///<\brief the index of the next child to visit
+} tree_walk_frame;
+
+/**
+ * @brief explicit stack of a non-recursive depth first tree walk
+ * 
+ * The stack holds a frame for each node on the path to the visited node,
+ * shallow trees are walked in the local storage, deeper trees on the heap.
+ */
+typedef struct
+{
+	tree_walk_frame *frames;	///<\brief the stacked frames
+	size_t size;				///<\brief the number of stacked frames
+	size_t capacity;			///<\brief the number of allocated frame slots
+	tree_walk_frame local[64];	///<\brief the initial storage
+} tree_walk;
+
+/**
+ * @brief Initialize an empty tree walk
+ * 
+ * @param w The tree walk
+ */
+static void tree_walk_init(tree_walk *w)
+{
+	w->frames = w->local;
+	w->size = 0;
+	w->capacity = sizeof(w->local) / sizeof(w->local[0]);
+}
+
+/**
+ * @brief Push a frame onto the stack of a tree walk
+ * 
+ * @param w The tree walk
+ * @param node The node to visit
+ * @param copy The copy of the node
+ * @return 0 on success, -1 if the stack could not grow
+ */
+static int tree_walk_push(tree_walk *w, syntax_tree node, syntax_tree copy)
+{
+	if (w->size == w->capacity)
+	{
+		size_t capacity = 2 * w->capacity;
+		tree_walk_frame *frames = w->frames == w->local ? malloc(capacity * sizeof(tree_walk_frame))
+														: realloc(w->frames, capacity * sizeof(tree_walk_frame));
+		if (frames == NULL)
+			return -1;
+		if (w->frames == w->local)
+			memcpy(frames, w->local, sizeof(w->local));
+		w->frames = frames;
+		w->capacity = capacity;
+	}
+	tree_walk_frame *frame = &w->frames[w->size++];
+	frame->node = node;
+	frame->copy = copy;
+	frame->next = 0;
+	return 0;
+}
+
+/**
+ * @brief Release the stack of a tree walk
+ * 
+ * @param w The tree walk
+ */
+static void tree_walk_free(tree_walk *w)
+{
+	if (w->frames != w->local)
+		free(w->frames);
+}
+
+/**
+ * @brief Release a single heap allocated node
+ * 
+ * @param t Pointer to the node
+ */
+static void syntax_tree_free_node(syntax_tree t)
+{
+	if (t->type == syntax_object)
+		free(t->data.object.index);
+	free(t->children);
+	if (t->flags & SYNTAX_FLAG_OWNED)
+		free((char *)t->data.string.ptr);
+	free(t);
+}
+
 void syntax_tree_delete(syntax_tree root)
 {
-	if (root == NULL)
+	// document trees are released with their arena
+	if (root == NULL || (root->flags & SYNTAX_FLAG_ARENA))
+		return;
+	tree_walk w;
+	tree_walk_init(&w);
+	if (tree_walk_push(&w, root, NULL) != 0)
 		return;
-	for (syntax_tree *c = root->children; c != NULL && *c != NULL; c++)
-		syntax_tree_delete(*c);
-	free(root->children);
-	free(root->data);
+	while (w.size > 0)
+	{
+		tree_walk_frame *top = &w.frames[w.size - 1];
+		if (top->next == top->node->num_children)
+		{
+			// the children have been released
+			syntax_tree_free_node(top->node);
+			w.size--;
+			continue;
+		}
+		syntax_tree c = top->node->children[top->next++];
+		// subtrees that cannot be stacked for lack of memory are leaked
+		if (c->num_children > 0)
+			tree_walk_push(&w, c, NULL);
+		else
+			syntax_tree_free_node(c);
+	}
+	tree_walk_free(&w);
 }
 
-void syntax_tree_add_child(syntax_tree tree, syntax_tree child)
+int syntax_tree_add_child(syntax_tree tree, syntax_tree child)
 {
-	size_t n = syntax_tree_num_children(tree);
-	size_t new_n = n + 1;
-	tree->children = realloc(tree->children, (new_n + 1) * sizeof(syntax_tree_elem));
-	tree->children[new_n - 1] = child;
-	tree->children[new_n] = NULL;
+	// the exactly sized children arrays of document trees are carved from the arena
+	if (tree->flags & SYNTAX_FLAG_ARENA)
+		return -1;
+	if (tree->num_children == tree->capacity)
+	{
+		// geometric growth, one extra slot holds the NULL terminator
+		size_t capacity = tree->capacity == 0 ? 4 : 2 * tree->capacity;
+		syntax_tree *children = realloc(tree->children, (capacity + 1) * sizeof(syntax_tree));
+		if (children == NULL)
+			return -1;
+		tree->children = children;
+		tree->capacity = capacity;
+	}
+	// the field index is rebuilt at the next lookup
+	if (tree->type == syntax_object)
+	{
+		if (tree->data.object.document == NULL)
+			free(tree->data.object.index);
+		tree->data.object.index = NULL;
+	}
+	tree->children[tree->num_children++] = child;
+	tree->children[tree->num_children] = NULL;
+	return 0;
 }
 
-static void syntax_tree_print_level(syntax_tree tree, FILE *fout, int depth)
+/**
+ * @brief Print a single syntax tree node
+ * 
+ * @param tree Pointer to the tree node
+ * @param fout Output stream
+ * @param depth The indentation depth
+ */
+static void syntax_tree_print_node(syntax_tree tree, FILE *fout, int depth)
 {
-	if (tree == NULL)
-		return;
-	for (size_t i = 0; i < depth; i++)
+	for (int i = 0; i < depth; i++)
 		fputc('\t', fout);
 	switch (tree->type)
 	{
@@ -84,13 +401,7 @@ static void syntax_tree_print_level(syntax_tree tree, FILE *fout, int depth)
 		break;
 	case syntax_string:
 		fprintf(fout, "STRING: ");
-		fprintf(fout, " %s", (char const *)tree->data);
-		break;
-	case syntax_elements:
-		fprintf(fout, "ELEMENTS");
-		break;
-	case syntax_members:
-		fprintf(fout, "MEMBERS");
+		fprintf(fout, " %.*s", (int)tree->data.string.len, tree->data.string.ptr);
 		break;
 	case syntax_true:
 		fprintf(fout, "TRUE");
@@ -103,365 +414,1196 @@ static void syntax_tree_print_level(syntax_tree tree, FILE *fout, int depth)
 		break;
 	case syntax_number:
 		fprintf(fout, "NUMBER: ");
-		fprintf(fout, " %f", *(double const *)tree->data);
+		if (tree->flags & SYNTAX_FLAG_RAW_NUMBER)
+			fprintf(fout, " %.*s", (int)tree->data.string.len, tree->data.string.ptr);
+		else
+			fprintf(fout, " %f", tree->data.number);
+		break;
+	case syntax_integer:
+		fprintf(fout, "INTEGER: ");
+		fprintf(fout, " %" PRId64, tree->data.integer);
+		break;
+	case syntax_unsigned:
+		fprintf(fout, "INTEGER: ");
+		fprintf(fout, " %" PRIu64, tree->data.uinteger);
 		break;
 	}
 	fputc('\n', fout);
-	for (syntax_tree *c = syntax_tree_first_child(tree); c != NULL; c = syntax_tree_next_sibling(c))
-		syntax_tree_print_level(*c, fout, depth + 1);
 }
 
 void syntax_tree_print(syntax_tree tree, FILE *fout)
 {
-	syntax_tree_print_level(tree, fout, 0);
+	if (tree == NULL)
+		return;
+	syntax_tree_print_node(tree, fout, 0);
+	tree_walk w;
+	tree_walk_init(&w);
+	if (tree_walk_push(&w, tree, NULL) != 0)
+		return;
+	while (w.size > 0)
+	{
+		tree_walk_frame *top = &w.frames[w.size - 1];
+		if (top->next == top->node->num_children)
+		{
+			w.size--;
+			continue;
+		}
+		syntax_tree c = top->node->children[top->next++];
+		// the stack size is the depth of the child
+		syntax_tree_print_node(c, fout, (int)w.size);
+		if (c->num_children > 0 && tree_walk_push(&w, c, NULL) != 0)
+			break;
+	}
+	tree_walk_free(&w);
+}
+
+/**
+ * @brief Copy a syntax tree node without its children
+ * 
+ * @param node Pointer to the node
+ * @return A newly allocated copy of the node or NULL if could not allocate
+ */
+static syntax_tree syntax_tree_copy_node(syntax_tree node)
+{
+	syntax_tree t = syntax_tree_node_create(NULL, node->type);
+	if (t == NULL)
+		return NULL;
+	// the field index is not shared, it is rebuilt for the copy on demand
+	if (node->type != syntax_object)
+		t->data = node->data;
+	// raw numbers share the text span with the original
+	t->flags = node->flags & SYNTAX_FLAG_RAW_NUMBER;
+	if (node->type == syntax_string)
+	{
+		t->data.string = strclone(node->data.string);
+		t->flags |= SYNTAX_FLAG_OWNED;
+	}
+	return t;
 }
 
 syntax_tree syntax_tree_copy(syntax_tree root)
 {
 	if (root == NULL)
 		return NULL;
-	syntax_tree t = syntax_tree_node_create(root->type, root->data);
-	for (syntax_tree *c = syntax_tree_first_child(root); c != NULL; c = syntax_tree_next_sibling(c))
-		syntax_tree_add_child(t, syntax_tree_copy(*c));
+	syntax_tree t = syntax_tree_copy_node(root);
+	tree_walk w;
+	tree_walk_init(&w);
+	if (t == NULL || tree_walk_push(&w, root, t) != 0)
+		return t;
+	while (w.size > 0)
+	{
+		tree_walk_frame *top = &w.frames[w.size - 1];
+		if (top->next == top->node->num_children)
+		{
+			w.size--;
+			continue;
+		}
+		syntax_tree c = top->node->children[top->next++];
+		syntax_tree copy = syntax_tree_copy_node(c);
+		if (copy == NULL)
+			break;
+		if (syntax_tree_add_child(top->copy, copy) != 0)
+		{
+			syntax_tree_delete(copy);
+			break;
+		}
+		if (c->num_children > 0 && tree_walk_push(&w, c, copy) != 0)
+			break;
+	}
+	tree_walk_free(&w);
 	return t;
 }
 
+/**
+ * @brief open addressing hash index of the fields of an object
+ */
+struct syntax_field_index
+{
+	size_t mask; ///<\brief the number of slots minus one
+	struct
+	{
+		uint64_t hash; ///<\brief the hash of the field name
+		size_t pair;   ///<\brief the index of the pair plus one or 0 for an empty slot
+	} slots[];		   ///<\brief the slots, a power of two at least twice the number of fields
+};
+
+/**
+ * @brief Compare the key of a field with a field name
+ * 
+ * Interned keys are compared by address.
+ * 
+ * @param key The key node of the field
+ * @param interned The interned field name or NULL if not interned
+ * @param fieldname The field name
+ * @param len The length of the field name
+ * @return Nonzero if the key is the field name
+ */
+static int field_name_matches(syntax_tree key, char const *interned, char const *fieldname, size_t len)
+{
+	if (interned != NULL && (key->flags & SYNTAX_FLAG_INTERNED))
+		return key->data.string.ptr == interned;
+	return key->data.string.len == len && memcmp(key->data.string.ptr, fieldname, len) == 0;
+}
+
+/**
+ * @brief Find the slot of a field name in a field index
+ * 
+ * @param object Pointer to the object node
+ * @param hash The hash of the field name
+ * @param interned The interned field name or NULL if not interned
+ * @param fieldname The field name
+ * @param len The length of the field name
+ * @return The index of the slot holding the field or of the empty slot ending the probe sequence
+ */
+static size_t field_index_find(syntax_tree object, uint64_t hash, char const *interned, char const *fieldname, size_t len)
+{
+	struct syntax_field_index const *index = object->data.object.index;
+	size_t i = (size_t)hash & index->mask;
+	// linear probing
+	for (; index->slots[i].pair != 0; i = (i + 1) & index->mask)
+	{
+		if (index->slots[i].hash != hash)
+			continue;
+		if (field_name_matches(object->children[index->slots[i].pair - 1]->children[0], interned, fieldname, len))
+			break;
+	}
+	return i;
+}
+
+/**
+ * @brief Build the field index of an object
+ * 
+ * For repeated field names the first field is indexed, like in the linear scan.
+ * 
+ * @param object Pointer to the object node
+ * @return 0 on success, -1 if could not allocate
+ */
+static int field_index_build(syntax_tree object)
+{
+	size_t n = 2;
+	while (n < 2 * object->num_children)
+		n *= 2;
+	size_t size = sizeof(struct syntax_field_index) + n * sizeof(((struct syntax_field_index *)NULL)->slots[0]);
+	json_document *doc = object->data.object.document;
+	struct syntax_field_index *index = tree_alloc(doc != NULL ? &doc->arena : NULL, size);
+	if (index == NULL)
+		return -1;
+	index->mask = n - 1;
+	for (size_t i = 0; i < n; i++)
+		index->slots[i].pair = 0;
+	object->data.object.index = index;
+	for (size_t c = 0; c < object->num_children; c++)
+	{
+		syntax_tree key = object->children[c]->children[0];
+		json_string name = key->data.string;
+		// interned keys are hashed once
+		char const *interned = key->flags & SYNTAX_FLAG_INTERNED ? name.ptr : NULL;
+		uint64_t hash = interned != NULL ? intern_entry(interned)->hash : json_hash(name.ptr, name.len);
+		size_t i = field_index_find(object, hash, interned, name.ptr, name.len);
+		if (index->slots[i].pair == 0)
+		{
+			index->slots[i].hash = hash;
+			index->slots[i].pair = c + 1;
+		}
+	}
+	return 0;
+}
+
 syntax_tree syntax_tree_get_field(syntax_tree object, char const *fieldname)
 {
 	if (object == NULL || object->type != syntax_object)
 		return NULL;
+	size_t len = strlen(fieldname);
+	json_document *doc = object->data.object.document;
+	int indexed = object->num_children >= SYNTAX_TREE_INDEX_THRESHOLD;
+	uint64_t hash = doc != NULL || indexed ? json_hash(fieldname, len) : 0;
+	char const *interned = NULL;
+	if (doc != NULL)
+	{
+		// a name missing from the key pool is not a key of any object of the document
+		size_t i = doc->keys.capacity > 0 ? intern_find(&doc->keys, hash, fieldname, len) : 0;
+		if (doc->keys.capacity == 0 || doc->keys.slots[i] == NULL)
+			return NULL;
+		interned = doc->keys.slots[i]->str;
+	}
+	if (indexed && (object->data.object.index != NULL || field_index_build(object) == 0))
+	{
+		size_t i = field_index_find(object, hash, interned, fieldname, len);
+		size_t pair = object->data.object.index->slots[i].pair;
+		return pair != 0 ? object->children[pair - 1]->children[1] : NULL;
+	}
+	// small objects are scanned
 	for (syntax_tree *c = object->children; c != NULL && *c != NULL; c++)
 	{
-		syntax_tree field = (*c)->children[0];
-		syntax_tree value = (*c)->children[1];
-		if (field->data != NULL && strcmp(field->data, fieldname) == 0)
-			return value;
+		if (field_name_matches((*c)->children[0], interned, fieldname, len))
+			return (*c)->children[1];
 	}
 	return NULL;
 }
 
-static syntax_tree parse_array(token_list tl, token_list *end);
-
-static syntax_tree parse_object(token_list tl, token_list *end);
-
 /**
- * @brief Clone a string by making a dynamic copy
+ * @brief Get a modifiable token from a token tape
  * 
- * @param str The input string
- * @return Pointer to the cloned string
+ * @param tape The token tape
+ * @param pos The position of the token
+ * @return Pointer to the stored token or NULL if the position is past the tape end
  */
-char *strclone(char const *str)
+static token_t *tape_token(token_tape *tape, size_t pos)
 {
-	char *s = malloc(strlen(str)+1);
-	return strcpy(s, str);
+	return pos < tape->size ? &tape->tokens[pos] : NULL;
 }
 
 /**
- * @brief Parse a string node
+ * @brief Convert a raw number node into its value
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * The node type becomes the type of the converted number.
+ * 
+ * @param node Pointer to the syntax tree node
+ * @return 0 on success, -1 if the text is not a number
  */
-static syntax_tree parse_string(token_list tl, token_list *end)
+static int syntax_tree_materialize_number(syntax_tree node)
 {
-	if (tl == NULL || tl->data.type != TOKEN_STRING)
-		return NULL;
-	*end = tl->next;
-	return syntax_tree_node_create(syntax_string, tl->data.value);
+	if (!(node->flags & SYNTAX_FLAG_RAW_NUMBER))
+		return 0;
+	token_t tok = {TOKEN_NUMBER, TOKEN_FLAG_RAW_NUMBER};
+	tok.value.string = node->data.string;
+	if (token_materialize_number(&tok) != 0)
+		return -1;
+	node->type = tok.type == TOKEN_INTEGER ? syntax_integer : tok.type == TOKEN_UNSIGNED ? syntax_unsigned : syntax_number;
+	node->data.uinteger = tok.value.uinteger;
+	node->flags &= ~SYNTAX_FLAG_RAW_NUMBER;
+	return 0;
+}
+
+int syntax_tree_get_double(syntax_tree node, double *value)
+{
+	if (node == NULL || syntax_tree_materialize_number(node) != 0)
+		return -1;
+	switch (node->type)
+	{
+	case syntax_number:
+		*value = node->data.number;
+		return 0;
+	case syntax_integer:
+		*value = (double)node->data.integer;
+		return 0;
+	case syntax_unsigned:
+		*value = (double)node->data.uinteger;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+int syntax_tree_get_int64(syntax_tree node, int64_t *value)
+{
+	if (node == NULL || syntax_tree_materialize_number(node) != 0)
+		return -1;
+	switch (node->type)
+	{
+	case syntax_integer:
+		*value = node->data.integer;
+		return 0;
+	case syntax_number:
+		// the range limits are powers of two, so they are exact doubles
+		if (!(node->data.number >= -0x1p63 && node->data.number < 0x1p63) ||
+			node->data.number != (double)(int64_t)node->data.number)
+			return -1;
+		*value = (int64_t)node->data.number;
+		return 0;
+	default:
+		// unsigned nodes are always above INT64_MAX
+		return -1;
+	}
+}
+
+int syntax_tree_get_uint64(syntax_tree node, uint64_t *value)
+{
+	if (node == NULL || syntax_tree_materialize_number(node) != 0)
+		return -1;
+	switch (node->type)
+	{
+	case syntax_unsigned:
+		*value = node->data.uinteger;
+		return 0;
+	case syntax_integer:
+		if (node->data.integer < 0)
+			return -1;
+		*value = (uint64_t)node->data.integer;
+		return 0;
+	case syntax_number:
+		if (!(node->data.number >= 0.0 && node->data.number < 0x1p64) ||
+			node->data.number != (double)(uint64_t)node->data.number)
+			return -1;
+		*value = (uint64_t)node->data.number;
+		return 0;
+	default:
+		return -1;
+	}
 }
 
 /**
- * @brief Clone a double number by making a dynamic copy
+ * @brief grammar states of the parser
+ */
+enum
+{
+	EXPECT_VALUE,		   ///<\brief a value after a colon or an array comma
+	EXPECT_VALUE_OR_CLOSE, ///<\brief the first element of an array or its end
+	EXPECT_KEY,			   ///<\brief a key after an object comma
+	EXPECT_KEY_OR_CLOSE,   ///<\brief the first key of an object or its end
+	EXPECT_COLON,		   ///<\brief the colon after a key
+	EXPECT_COMMA_OR_CLOSE, ///<\brief a comma or the end of the container after a value
+	PARSE_DONE			   ///<\brief the root has been closed
+};
+
+/**
+ * @brief State shared by the parsing functions
  * 
- * @param d The input number
- * @return pointer to the dynamically copied instance
+ * The tokens are read from a token tape or pulled on demand from a lexer,
+ * and are processed one by one without recursion.
+ * The children of the open containers are collected on a common scratch stack,
+ * a container takes its children from the stack when its closing bracket is reached.
+ * Object keys wait on the scratch stack until their value is parsed.
+ * The open containers are stored on the frame stack as the scratch stack position
+ * of their first child shifted left by one, the lowest bit is set for objects.
  */
-double *number_clone(double const *d)
+typedef struct
 {
-	if (d == NULL)
-		return NULL;
-	double *ret = malloc(sizeof(double));
-	*ret = *d;
-	return ret;
-}
+	token_tape *tape;	///<\brief the token tape being parsed or NULL if pulling from a lexer
+	json_lexer *lexer;	///<\brief the lexer the tokens are pulled from
+	token_t tok;		///<\brief the last pulled token
+	size_t pulled;		///<\brief the number of pulled tokens
+	int status;			///<\brief the result of the last pull
+	json_document *document; ///<\brief the document owning the tree or NULL for heap allocated trees
+	json_arena *arena;	///<\brief the document arena or NULL for heap allocated trees
+	syntax_tree *stack; ///<\brief the scratch stack of parsed children
+	size_t size;		///<\brief the number of nodes on the scratch stack
+	size_t capacity;	///<\brief the number of allocated scratch stack slots
+	size_t *frames;		///<\brief the frame stack of the open containers
+	size_t depth;		///<\brief the number of open containers
+	size_t frames_capacity; ///<\brief the number of allocated frame stack slots
+	size_t max_depth;	///<\brief the maximal number of nested containers
+	int state;			///<\brief the grammar state
+	syntax_tree root;	///<\brief the parsed root when the state is PARSE_DONE
+} parser_state;
 
 /**
- * @brief Parse a number node
+ * @brief Get the token at a position
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * When pulling from a lexer only the token at the last requested position is kept,
+ * the parser never looks back to an earlier position.
+ * 
+ * @param ps The parser state
+ * @param pos The position of the token
+ * @return Pointer to the token or NULL at the end of the input or on lexer error
  */
-static syntax_tree parse_number(token_list tl, token_list *end)
+static token_t *parser_token(parser_state *ps, size_t pos)
 {
-	if (tl == NULL || tl->data.type != TOKEN_NUMBER)
-		return NULL;
-	*end = tl->next;
-	return syntax_tree_node_create(syntax_number, number_clone(tl->data.value));
+	if (ps->lexer == NULL)
+		return tape_token(ps->tape, pos);
+	while (ps->pulled <= pos)
+	{
+		// release the string of the previous token unless it was moved into the tree
+		if (ps->status == 1)
+			token_free(&ps->tok);
+		ps->status = json_lexer_next(ps->lexer, &ps->tok);
+		if (ps->status != 1)
+			return NULL;
+		ps->pulled++;
+	}
+	return pos + 1 == ps->pulled ? &ps->tok : NULL;
 }
 
 /**
- * @brief Parse a true node
+ * @brief Push a child node onto the scratch stack
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * @param ps The parser state
+ * @param child The parsed child node
+ * @return 0 on success, -1 if the stack could not grow
  */
-static syntax_tree parse_true(token_list tl, token_list *end)
+static int parser_push(parser_state *ps, syntax_tree child)
 {
-	if (tl == NULL || tl->data.type != TOKEN_TRUE)
-		return NULL;
-	*end = tl->next;
-	return syntax_tree_node_create(syntax_true, NULL);
+	if (ps->size == ps->capacity)
+	{
+		size_t capacity = ps->capacity == 0 ? 64 : 2 * ps->capacity;
+		syntax_tree *stack = realloc(ps->stack, capacity * sizeof(syntax_tree));
+		if (stack == NULL)
+			return -1;
+		ps->stack = stack;
+		ps->capacity = capacity;
+	}
+	ps->stack[ps->size++] = child;
+	return 0;
 }
 
 /**
- * @brief Parse a false node
+ * @brief Move the nodes above a base position from the scratch stack into a container node
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * The children array is allocated with its exact size.
+ * 
+ * @param ps The parser state
+ * @param base The stack size when the container was opened
+ * @param type The container node identifier
+ * @return The container node or NULL if could not allocate
  */
-static syntax_tree parse_false(token_list tl, token_list *end)
+static syntax_tree parser_pop_container(parser_state *ps, size_t base, syntax_type_t type)
 {
-	if (tl == NULL || tl->data.type != TOKEN_FALSE)
+	syntax_tree st = syntax_tree_node_create(ps->arena, type);
+	if (st == NULL)
 		return NULL;
-	*end = tl->next;
-	return syntax_tree_node_create(syntax_false, NULL);
+	size_t n = ps->size - base;
+	if (n > 0)
+	{
+		st->children = tree_alloc(ps->arena, (n + 1) * sizeof(syntax_tree));
+		if (st->children == NULL)
+		{
+			syntax_tree_delete(st);
+			return NULL;
+		}
+		memcpy(st->children, ps->stack + base, n * sizeof(syntax_tree));
+		st->children[n] = NULL;
+		st->num_children = n;
+		st->capacity = n;
+	}
+	if (type == syntax_object)
+		st->data.object.document = ps->document;
+	ps->size = base;
+	return st;
 }
 
 /**
- * @brief Parse a null node
+ * @brief Create a string node referring to a string interned in a pool of the document
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * @param ps The parser state
+ * @param pool The key or value pool of the document
+ * @param tok The string token
+ * @param flag The node flag marking the pool
+ * @return The string node or NULL if could not allocate
  */
-static syntax_tree parse_null(token_list tl, token_list *end)
+static syntax_tree parser_interned_string(parser_state *ps, json_intern_pool *pool, token_t *tok, unsigned flag)
 {
-	if (tl == NULL || tl->data.type != TOKEN_NULL)
+	char const *body = intern_string(pool, ps->arena, tok->value.string);
+	syntax_tree st = body != NULL ? syntax_tree_node_create(ps->arena, syntax_string) : NULL;
+	if (st == NULL)
 		return NULL;
-	*end = tl->next;
-	return syntax_tree_node_create(syntax_null, NULL);
+	st->flags |= flag;
+	st->data.string.ptr = body;
+	st->data.string.len = tok->value.string.len;
+	return st;
 }
 
 /**
- * @brief Parse a value node
+ * @brief Create a scalar node from a token
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * @param ps The parser state
+ * @param tok The token
+ * @return The scalar node or NULL if the token is not a scalar or could not allocate
  */
-static syntax_tree parse_value(token_list tl, token_list *end)
+static syntax_tree parser_scalar(parser_state *ps, token_t *tok)
 {
-	typedef syntax_tree (*parsing_function_t)(token_list, token_list *);
-	parsing_function_t pfs[] = {parse_object, parse_array, parse_true, parse_false, parse_null, parse_string, parse_number, NULL};
 	syntax_tree st;
-	for (int i = 0; pfs[i] != NULL; i++)
-		if ((st = pfs[i](tl, end)) != NULL)
-			return st;
-	return NULL;
+	switch (tok->type)
+	{
+	case TOKEN_STRING:
+		if (ps->document != NULL && ps->document->dictionary)
+			return parser_interned_string(ps, &ps->document->values, tok, SYNTAX_FLAG_DICT);
+		return syntax_tree_string_create(ps->arena, tok);
+	case TOKEN_TRUE:
+		return syntax_tree_node_create(ps->arena, syntax_true);
+	case TOKEN_FALSE:
+		return syntax_tree_node_create(ps->arena, syntax_false);
+	case TOKEN_NULL:
+		return syntax_tree_node_create(ps->arena, syntax_null);
+	case TOKEN_NUMBER:
+		st = syntax_tree_node_create(ps->arena, syntax_number);
+		break;
+	case TOKEN_INTEGER:
+		st = syntax_tree_node_create(ps->arena, syntax_integer);
+		break;
+	case TOKEN_UNSIGNED:
+		st = syntax_tree_node_create(ps->arena, syntax_unsigned);
+		break;
+	default:
+		return NULL;
+	}
+	if (st == NULL)
+		return NULL;
+	if (tok->flags & TOKEN_FLAG_RAW_NUMBER)
+	{
+		st->flags |= SYNTAX_FLAG_RAW_NUMBER;
+		st->data.string = tok->value.string;
+	}
+	else
+		// the token and node unions store numbers in the same 64 bits
+		st->data.uinteger = tok->value.uinteger;
+	return st;
 }
 
 /**
- * @brief Parse a pair node
+ * @brief Store a complete value in its container
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * Values of objects are paired with the key waiting on the scratch stack.
+ * 
+ * @param ps The parser state
+ * @param value The value node
+ * @return 0 on success, -1 if could not allocate
  */
-static syntax_tree parse_pair(token_list tl, token_list *end)
+static int parser_value_done(parser_state *ps, syntax_tree value)
 {
-	if (tl == NULL)
-		return NULL;
-	*end = tl;
+	if (ps->depth == 0)
+	{
+		ps->root = value;
+		ps->state = PARSE_DONE;
+		return 0;
+	}
+	ps->state = EXPECT_COMMA_OR_CLOSE;
+	if (!(ps->frames[ps->depth - 1] & 1))
+	{
+		if (parser_push(ps, value) == 0)
+			return 0;
+		syntax_tree_delete(value);
+		return -1;
+	}
 
-	if (tl->data.type != TOKEN_STRING)
-		return NULL;
-	char const *fieldname = tl->data.value;
-	tl = tl->next;
-	if (tl == NULL || tl->data.type != TOKEN_PUNCTUATOR_COLON)
-		return NULL;
-	tl = tl->next;
-	token_list e;
-	syntax_tree value = parse_value(tl, &e);
-	if (value == NULL)
-		return NULL;
-	*end = e;
+	syntax_tree pair = syntax_tree_node_create(ps->arena, syntax_pair);
+	syntax_tree *children = pair != NULL ? tree_alloc(ps->arena, 3 * sizeof(syntax_tree)) : NULL;
+	if (children == NULL)
+	{
+		syntax_tree_delete(pair);
+		syntax_tree_delete(value);
+		return -1;
+	}
+	// the key is replaced by the pair on the scratch stack
+	children[0] = ps->stack[ps->size - 1];
+	children[1] = value;
+	children[2] = NULL;
+	pair->children = children;
+	pair->num_children = pair->capacity = 2;
+	ps->stack[ps->size - 1] = pair;
+	return 0;
+}
 
-	syntax_tree pair = syntax_tree_node_create(syntax_pair, NULL);
-	syntax_tree_add_child(pair, syntax_tree_node_create(syntax_string, strclone(fieldname)));
-	syntax_tree_add_child(pair, value);
-	return pair;
+/**
+ * @brief Open a container
+ * 
+ * @param ps The parser state
+ * @param object Nonzero for an object, zero for an array
+ * @return 0 on success, -1 if the depth limit is exceeded or could not allocate
+ */
+static int parser_open(parser_state *ps, int object)
+{
+	if (ps->depth >= ps->max_depth)
+		return -1;
+	if (ps->depth == ps->frames_capacity)
+	{
+		size_t capacity = ps->frames_capacity == 0 ? 64 : 2 * ps->frames_capacity;
+		size_t *frames = realloc(ps->frames, capacity * sizeof(size_t));
+		if (frames == NULL)
+			return -1;
+		ps->frames = frames;
+		ps->frames_capacity = capacity;
+	}
+	ps->frames[ps->depth++] = ps->size << 1 | (object != 0);
+	ps->state = object ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+	return 0;
 }
 
 /**
- * @brief Parse an elements node
+ * @brief Close the innermost container
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * @param ps The parser state
+ * @param object Nonzero for a closing brace, zero for a closing bracket
+ * @return 0 on success, -1 if the bracket does not match or could not allocate
  */
-static syntax_tree parse_elements(token_list tl, token_list *end)
+static int parser_close(parser_state *ps, int object)
 {
-	if (tl == NULL)
-		return NULL;
-	*end = tl;
+	size_t frame = ps->frames[ps->depth - 1];
+	if ((int)(frame & 1) != (object != 0))
+		return -1;
+	syntax_tree st = parser_pop_container(ps, frame >> 1, object ? syntax_object : syntax_array);
+	if (st == NULL)
+		return -1;
+	ps->depth--;
+	return parser_value_done(ps, st);
+}
 
-	token_list t = tl;
-	token_list e;
-	syntax_tree v = parse_value(t, &e);
-	if (v == NULL)
-		return NULL;
-	t = e;
+/**
+ * @brief Process a value token
+ * 
+ * @param ps The parser state
+ * @param tok The token
+ * @return 0 on success, -1 if the token is not a value or could not allocate
+ */
+static int parser_value(parser_state *ps, token_t *tok)
+{
+	switch (tok->type)
+	{
+	case TOKEN_BRACKET_ARRAY_OPEN:
+		return parser_open(ps, 0);
+	case TOKEN_BRACKET_OBJECT_OPEN:
+		return parser_open(ps, 1);
+	default:
+		break;
+	}
+	syntax_tree st = parser_scalar(ps, tok);
+	if (st == NULL)
+		return -1;
+	return parser_value_done(ps, st);
+}
 
-	syntax_tree elements = syntax_tree_node_create(syntax_elements, NULL);
-	syntax_tree_add_child(elements, v);
+/**
+ * @brief Process a key token
+ * 
+ * @param ps The parser state
+ * @param tok The token
+ * @return 0 on success, -1 if the token is not a string or could not allocate
+ */
+static int parser_key(parser_state *ps, token_t *tok)
+{
+	if (tok->type != TOKEN_STRING)
+		return -1;
+	// the keys of a document refer to their single interned copy
+	syntax_tree key = ps->document != NULL
+						  ? parser_interned_string(ps, &ps->document->keys, tok, SYNTAX_FLAG_INTERNED)
+						  : syntax_tree_string_create(NULL, tok);
+	if (key == NULL)
+		return -1;
+	if (parser_push(ps, key) != 0)
+	{
+		syntax_tree_delete(key);
+		return -1;
+	}
+	ps->state = EXPECT_COLON;
+	return 0;
+}
 
-	while (t != NULL && get_token(t)->type == TOKEN_PUNCTUATOR_COMMA)
+/**
+ * @brief Process the next token
+ * 
+ * @param ps The parser state
+ * @param tok The token, its dynamically allocated string may be moved into the tree
+ * @return 0 on success, -1 if the token could not be interpreted
+ */
+static int parser_step(parser_state *ps, token_t *tok)
+{
+	switch (ps->state)
 	{
-		t = t->next;
-		syntax_tree v = parse_value(t, &e);
-		if (v == NULL)
+	case EXPECT_VALUE:
+		return parser_value(ps, tok);
+	case EXPECT_VALUE_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_ARRAY_CLOSE)
+			return parser_close(ps, 0);
+		return parser_value(ps, tok);
+	case EXPECT_KEY_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_OBJECT_CLOSE)
+			return parser_close(ps, 1);
+		return parser_key(ps, tok);
+	case EXPECT_KEY:
+		return parser_key(ps, tok);
+	case EXPECT_COLON:
+		if (tok->type != TOKEN_PUNCTUATOR_COLON)
+			return -1;
+		ps->state = EXPECT_VALUE;
+		return 0;
+	case EXPECT_COMMA_OR_CLOSE:
+		switch (tok->type)
 		{
-			syntax_tree_delete(elements);
-			return NULL;
+		case TOKEN_PUNCTUATOR_COMMA:
+			ps->state = ps->frames[ps->depth - 1] & 1 ? EXPECT_KEY : EXPECT_VALUE;
+			return 0;
+		case TOKEN_BRACKET_ARRAY_CLOSE:
+			return parser_close(ps, 0);
+		case TOKEN_BRACKET_OBJECT_CLOSE:
+			return parser_close(ps, 1);
+		default:
+			return -1;
 		}
-		syntax_tree_add_child(elements, v);
-		t = e;
+	default:
+		return -1;
 	}
-
-	*end = e;
-	return elements;
 }
 
 /**
- * @brief Parse a members node
+ * @brief Parse the root node
+ * 
+ * The tokens are processed in a loop until the root is closed.
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
+ * @param ps The parser state
+ * @param[out] end Position of the first uninterpreted token
  * @return The interpreted syntax tree or NULL if could not interpret
  */
-static syntax_tree parse_members(token_list tl, token_list *end)
+static syntax_tree parse_root(parser_state *ps, size_t *end)
 {
-	if (tl == NULL)
+	*end = 0;
+	ps->state = EXPECT_VALUE;
+	ps->depth = 0;
+	ps->size = 0;
+	ps->root = NULL;
+	token_t *tok = parser_token(ps, 0);
+	// the root is an array or an object
+	if (tok == NULL || (tok->type != TOKEN_BRACKET_ARRAY_OPEN && tok->type != TOKEN_BRACKET_OBJECT_OPEN))
 		return NULL;
-	*end = tl;
-
-	token_list t = tl;
-	token_list e;
-	syntax_tree p = parse_pair(t, &e);
-	if (p == NULL)
-		return NULL;
-	t = e;
-
-	syntax_tree members = syntax_tree_node_create(syntax_members, NULL);
-	syntax_tree_add_child(members, p);
-
-	while (t != NULL && get_token(t)->type == TOKEN_PUNCTUATOR_COMMA)
+	for (size_t pos = 0; (tok = parser_token(ps, pos)) != NULL; pos++)
 	{
-		t = t->next;
-		p = parse_pair(t, &e);
-		if (p == NULL)
+		if (parser_step(ps, tok) != 0)
+			break;
+		if (ps->state == PARSE_DONE)
 		{
-			syntax_tree_delete(members);
-			return NULL;
+			*end = pos + 1;
+			return ps->root;
 		}
-		syntax_tree_add_child(members, p);
-		t = e;
 	}
+	// release the parsed children of the open containers
+	while (ps->size > 0)
+		syntax_tree_delete(ps->stack[--ps->size]);
+	return NULL;
+}
 
-	*end = e;
-	return members;
+/**
+ * @brief Initialize the parser state
+ * 
+ * @param ps The parser state
+ * @param tape The token tape or NULL if pulling from a lexer
+ * @param lexer The lexer or NULL if reading a token tape
+ * @param document The document owning the tree or NULL for heap allocated trees
+ */
+static void parser_init(parser_state *ps, token_tape *tape, json_lexer *lexer, json_document *document)
+{
+	ps->tape = tape;
+	ps->lexer = lexer;
+	ps->pulled = 0;
+	ps->status = 0;
+	ps->document = document;
+	ps->arena = document != NULL ? &document->arena : NULL;
+	ps->stack = NULL;
+	ps->size = 0;
+	ps->capacity = 0;
+	ps->frames = NULL;
+	ps->depth = 0;
+	ps->frames_capacity = 0;
+	ps->max_depth = PARSE_JSON_MAX_DEPTH;
+	ps->state = EXPECT_VALUE;
+	ps->root = NULL;
 }
 
 /**
- * @brief Parse an array node
+ * @brief Check that the lexer of the parser has no more tokens
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * The last pulled token is released.
+ * 
+ * @param ps The parser state
+ * @return 0 if the input is exhausted, -1 if there are trailing tokens or characters
  */
-static syntax_tree parse_array(token_list tl, token_list *end)
+static int parser_finish(parser_state *ps)
 {
-	if (tl == NULL)
+	if (ps->status == 1)
+		token_free(&ps->tok);
+	ps->status = json_lexer_next(ps->lexer, &ps->tok);
+	if (ps->status == 1)
+		token_free(&ps->tok);
+	return ps->status == 0 ? 0 : -1;
+}
+
+syntax_tree parse_json_tape(token_tape *tape, size_t *end)
+{
+	parser_state ps;
+	parser_init(&ps, tape, NULL, NULL);
+	syntax_tree s = parse_root(&ps, end);
+	free(ps.stack);
+	free(ps.frames);
+	return s;
+}
+
+syntax_tree parse_json_from_buffer(char const *buf, size_t len, unsigned flags, size_t *end)
+{
+	json_lexer lexer;
+	json_lexer_init(&lexer, buf, len, flags & ~LEX_RAW_ESCAPES);
+	parser_state ps;
+	parser_init(&ps, NULL, &lexer, NULL);
+	size_t e;
+	syntax_tree s = parse_root(&ps, &e);
+	// the parser stops at the closing bracket of the root
+	*end = s != NULL ? (size_t)(lexer.str - buf) : 0;
+	if (ps.status == 1)
+		token_free(&ps.tok);
+	free(ps.stack);
+	free(ps.frames);
+	return s;
+}
+
+json_document *json_document_create(void)
+{
+	json_document *doc = malloc(sizeof(json_document));
+	if (doc == NULL)
 		return NULL;
-	*end = tl;
+	json_arena_init(&doc->arena);
+	doc->keys.slots = NULL;
+	doc->keys.capacity = 0;
+	doc->keys.size = 0;
+	doc->values.slots = NULL;
+	doc->values.capacity = 0;
+	doc->values.size = 0;
+	doc->dictionary = 0;
+	doc->root = NULL;
+	doc->stack = NULL;
+	doc->stack_capacity = 0;
+	doc->frames = NULL;
+	doc->frames_capacity = 0;
+	doc->max_depth = PARSE_JSON_MAX_DEPTH;
+	return doc;
+}
 
-	token_list t = tl;
-	if (get_token(t) == NULL || get_token(t)->type != TOKEN_BRACKET_ARRAY_OPEN)
+/**
+ * @brief Parse the root of a document
+ * 
+ * The stacks of the document are lent to the parser, the previous trees are kept.
+ * 
+ * @param doc The document
+ * @param ps The initialized parser state
+ * @param[out] end Position of the first uninterpreted token
+ * @return The root of the syntax tree or NULL if could not interpret
+ */
+static syntax_tree json_document_parse(json_document *doc, parser_state *ps, size_t *end)
+{
+	ps->stack = doc->stack;
+	ps->capacity = doc->stack_capacity;
+	ps->frames = doc->frames;
+	ps->frames_capacity = doc->frames_capacity;
+	ps->max_depth = doc->max_depth;
+	doc->root = parse_root(ps, end);
+	doc->stack = ps->stack;
+	doc->stack_capacity = ps->capacity;
+	doc->frames = ps->frames;
+	doc->frames_capacity = ps->frames_capacity;
+	return doc->root;
+}
+
+syntax_tree json_document_parse_tape(json_document *doc, token_tape *tape, size_t *end)
+{
+	json_document_reset(doc);
+	return json_document_append_tape(doc, tape, end);
+}
+
+syntax_tree json_document_append_tape(json_document *doc, token_tape *tape, size_t *end)
+{
+	parser_state ps;
+	parser_init(&ps, tape, NULL, doc);
+	return json_document_parse(doc, &ps, end);
+}
+
+syntax_tree json_document_parse_buffer(json_document *doc, char const *buf, size_t len, unsigned flags)
+{
+	// the tokens are pulled while parsing, no token tape is built
+	json_lexer lexer;
+	json_lexer_init(&lexer, buf, len, flags & ~LEX_RAW_ESCAPES);
+	parser_state ps;
+	parser_init(&ps, NULL, &lexer, doc);
+	size_t end;
+	json_document_reset(doc);
+	json_document_parse(doc, &ps, &end);
+	// trailing tokens are an error
+	if (parser_finish(&ps) != 0)
+		doc->root = NULL;
+	return doc->root;
+}
+
+void json_document_set_dictionary(json_document *doc, int enabled)
+{
+	doc->dictionary = enabled != 0;
+}
+
+int json_document_set_max_depth(json_document *doc, size_t max_depth)
+{
+	if (max_depth == 0)
+		return -1;
+	doc->max_depth = max_depth;
+	return 0;
+}
+
+void json_document_reset(json_document *doc)
+{
+	doc->root = NULL;
+	json_arena_reset(&doc->arena);
+	// the interned strings lived in the arena
+	intern_clear(&doc->keys);
+	intern_clear(&doc->values);
+}
+
+void json_document_delete(json_document *doc)
+{
+	if (doc == NULL)
+		return;
+	json_arena_free(&doc->arena);
+	free(doc->keys.slots);
+	free(doc->values.slots);
+	free(doc->stack);
+	free(doc->frames);
+	free(doc);
+}
+
+/**
+ * @brief scanning states of the token split by a chunk boundary
+ */
+enum
+{
+	STREAM_IDLE,   ///<\brief no token is carried over
+	STREAM_STRING, ///<\brief the carried string waits for its closing quote
+	STREAM_SCALAR  ///<\brief the carried number or keyword waits for a delimiter
+};
+
+/**
+ * @brief state of the incremental parser
+ * 
+ * A token split by a chunk boundary is collected in the carry buffer, the chunks are
+ * scanned only for the end of the carried token, so each character is scanned once.
+ * Complete tokens are lexed with the pull lexer and fed to the parser state machine.
+ */
+struct json_stream
+{
+	parser_state ps;	   ///<\brief the parser the tokens are fed to
+	json_document *doc;	   ///<\brief the document receiving the tree or NULL
+	int error;			   ///<\brief nonzero after an error
+	int scan;			   ///<\brief the scanning state of the carried token
+	int escaped;		   ///<\brief the next character of the carried string is escaped
+	char *carry;		   ///<\brief the characters of the carried token
+	size_t carry_size;	   ///<\brief the number of carried characters
+	size_t carry_capacity; ///<\brief the number of allocated carry characters
+	size_t line_cntr;	   ///<\brief the current line number
+};
+
+json_stream *json_stream_create(json_document *doc)
+{
+	json_stream *stream = malloc(sizeof(json_stream));
+	if (stream == NULL)
 		return NULL;
-	t = t->next;
+	if (doc != NULL)
+		json_document_reset(doc);
+	parser_init(&stream->ps, NULL, NULL, doc);
+	if (doc != NULL)
+		stream->ps.max_depth = doc->max_depth;
+	stream->doc = doc;
+	stream->error = 0;
+	stream->scan = STREAM_IDLE;
+	stream->escaped = 0;
+	stream->carry = NULL;
+	stream->carry_size = 0;
+	stream->carry_capacity = 0;
+	stream->line_cntr = 1;
+	return stream;
+}
 
-	token_list e;
-	syntax_tree elements = parse_elements(t, &e);
-	t = e;
+/**
+ * @brief Lex a complete token and feed it to the parser
+ * 
+ * @param stream The parser
+ * @param str The first character of the token
+ * @param len The number of characters of the token
+ * @return 0 on success, -1 if the characters are not a single token or the token could not be interpreted
+ */
+static int stream_token(json_stream *stream, char const *str, size_t len)
+{
+	json_lexer lexer;
+	json_lexer_init(&lexer, str, len, 0);
+	lexer.line_cntr = stream->line_cntr;
+	token_t tok;
+	if (json_lexer_next(&lexer, &tok) != 1)
+		return -1;
+	int ret = -1;
+	// the root is an array or an object
+	if (lexer.str == lexer.end &&
+		(stream->ps.depth > 0 || tok.type == TOKEN_BRACKET_ARRAY_OPEN || tok.type == TOKEN_BRACKET_OBJECT_OPEN))
+		ret = parser_step(&stream->ps, &tok);
+	token_free(&tok);
+	return ret;
+}
 
-	if (get_token(t) == NULL || get_token(t)->type != TOKEN_BRACKET_ARRAY_CLOSE)
+/**
+ * @brief Find the end of a string
+ * 
+ * @param str The first character to scan
+ * @param end Pointer past the last character of the chunk
+ * @param escaped[in,out] Nonzero if the first character is escaped
+ * @return Pointer past the closing quote or NULL if the string continues in the next chunk
+ */
+static char const *string_end(char const *str, char const *end, int *escaped)
+{
+	for (; str != end; str++)
 	{
-		syntax_tree_delete(elements);
-		return NULL;
+		if (*escaped)
+			*escaped = 0;
+		else if (*str == '\\')
+			*escaped = 1;
+		else if (*str == '"')
+			return str + 1;
 	}
-	t = t->next;
+	return NULL;
+}
 
-	syntax_tree st = syntax_tree_node_create(syntax_array, NULL);
-	if (elements != NULL)
+/**
+ * @brief Find the end of a number or keyword
+ * 
+ * @param str The first character to scan
+ * @param end Pointer past the last character of the chunk
+ * @return Pointer to the delimiter or NULL if the token may continue in the next chunk
+ */
+static char const *scalar_end(char const *str, char const *end)
+{
+	for (; str != end; str++)
 	{
-		for (syntax_tree *c = elements->children; c != NULL && *c != NULL; c++)
+		switch (*str)
 		{
-			syntax_tree_add_child(st, *c);
-			*c = NULL;
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+		case ',':
+		case ':':
+		case '[':
+		case ']':
+		case '{':
+		case '}':
+			return str;
+		default:
+			break;
 		}
-		syntax_tree_delete(elements);
 	}
-
-	*end = t;
-	return st;
+	return NULL;
 }
 
 /**
- * @brief Parse an object node
+ * @brief Carry the characters of a split token
  * 
- * @param tl Pointer to the token list
- * @param[out] end Pointer to the first uninterpreted element of the token list
- * @return The interpreted syntax tree or NULL if could not interpret
+ * When the end of the token is found the carried token is lexed and parsed.
+ * 
+ * @param stream The parser
+ * @param str The first character to carry
+ * @param close Pointer past the token or NULL if the token continues in the next chunk
+ * @param end Pointer past the last character of the chunk
+ * @return Pointer to the first character not carried
  */
-static syntax_tree parse_object(token_list tl, token_list *end)
+static char const *stream_carry(json_stream *stream, char const *str, char const *close, char const *end)
 {
-	if (tl == NULL)
-		return NULL;
-	*end = tl;
-
-	token_list t = tl;
-	if (get_token(t) == NULL || get_token(t)->type != TOKEN_BRACKET_OBJECT_OPEN)
-		return NULL;
-	t = t->next;
+	size_t n = (close != NULL ? close : end) - str;
+	if (stream->carry_size + n > stream->carry_capacity)
+	{
+		size_t capacity = stream->carry_capacity == 0 ? 64 : 2 * stream->carry_capacity;
+		while (capacity < stream->carry_size + n)
+			capacity *= 2;
+		char *carry = realloc(stream->carry, capacity);
+		if (carry == NULL)
+		{
+			stream->error = 1;
+			return end;
+		}
+		stream->carry = carry;
+		stream->carry_capacity = capacity;
+	}
+	memcpy(stream->carry + stream->carry_size, str, n);
+	stream->carry_size += n;
+	if (close == NULL)
+		return end;
+	stream->scan = STREAM_IDLE;
+	if (stream_token(stream, stream->carry, stream->carry_size) != 0)
+		stream->error = 1;
+	stream->carry_size = 0;
+	return close;
+}
 
-	token_list e;
-	syntax_tree members = parse_members(t, &e);
-	t = e;
+/**
+ * @brief Scan the next token or white space of a chunk
+ * 
+ * @param stream The parser
+ * @param str The first unscanned character
+ * @param end Pointer past the last character of the chunk
+ * @return Pointer to the first unscanned character
+ */
+static char const *stream_scan(json_stream *stream, char const *str, char const *end)
+{
+	char const *close;
+	switch (stream->scan)
+	{
+	case STREAM_STRING:
+		return stream_carry(stream, str, string_end(str, end, &stream->escaped), end);
+	case STREAM_SCALAR:
+		return stream_carry(stream, str, scalar_end(str, end), end);
+	default:
+		break;
+	}
 
-	if (get_token(t) == NULL || get_token(t)->type != TOKEN_BRACKET_OBJECT_CLOSE)
+	switch (*str)
 	{
-		syntax_tree_delete(members);
-		return NULL;
+	case '\n':
+		stream->line_cntr++;
+		return str + 1;
+	case ' ':
+	case '\t':
+	case '\r':
+		return str + 1;
+	case ',':
+	case ':':
+	case '[':
+	case ']':
+	case '{':
+	case '}':
+		close = str + 1;
+		break;
+	case '"':
+		stream->escaped = 0;
+		close = string_end(str + 1, end, &stream->escaped);
+		stream->scan = STREAM_STRING;
+		break;
+	default:
+		close = scalar_end(str, end);
+		stream->scan = STREAM_SCALAR;
+		break;
 	}
-	t = t->next;
+	if (close == NULL)
+		return stream_carry(stream, str, NULL, end);
+	// tokens inside the chunk are lexed in place
+	stream->scan = STREAM_IDLE;
+	if (stream_token(stream, str, close - str) != 0)
+		stream->error = 1;
+	return close;
+}
+
+int json_stream_feed(json_stream *stream, char const *chunk, size_t len)
+{
+	char const *str = chunk;
+	char const *end = chunk + len;
+	while (!stream->error && str != end)
+		str = stream_scan(stream, str, end);
+	return stream->error ? -1 : 0;
+}
 
-	syntax_tree st = syntax_tree_node_create(syntax_object, NULL);
-	if (members != NULL)
+syntax_tree json_stream_finish(json_stream *stream)
+{
+	// a number or keyword is also delimited by the end of the input
+	if (!stream->error && stream->scan == STREAM_SCALAR)
+		stream_carry(stream, stream->carry, stream->carry, stream->carry);
+	if (stream->error || stream->scan != STREAM_IDLE || stream->ps.state != PARSE_DONE)
 	{
-		for (syntax_tree *c = members->children; c != NULL && *c != NULL; c++)
-		{
-			syntax_tree_add_child(st, *c);
-			*c = NULL;
-		}
-		syntax_tree_delete(members);
+		stream->error = 1;
+		return NULL;
 	}
+	syntax_tree root = stream->ps.root;
+	// the tree is handed over to the caller or the document
+	stream->ps.root = NULL;
+	if (stream->doc != NULL)
+		stream->doc->root = root;
+	return root;
+}
 
-	*end = t;
-	return st;
+void json_stream_delete(json_stream *stream)
+{
+	if (stream == NULL)
+		return;
+	while (stream->ps.size > 0)
+		syntax_tree_delete(stream->ps.stack[--stream->ps.size]);
+	syntax_tree_delete(stream->ps.root);
+	free(stream->ps.stack);
+	free(stream->ps.frames);
+	free(stream->carry);
+	free(stream);
 }
 
 syntax_tree parse_json(token_list tl, token_list *end)
@@ -469,15 +1611,50 @@ syntax_tree parse_json(token_list tl, token_list *end)
 	*end = tl;
 	if (tl == NULL)
 		return NULL;
-	// try to parse an array
-	syntax_tree s = parse_array(tl, end);
-	if (s != NULL)
-		return s;
-	// try to parse an object
-	s = parse_object(tl, end);
+
+	// pack the tokens up to the closing bracket of the root into a temporary tape,
+	// the tokens after the root are not visited
+	size_t n = 0;
+	size_t depth = 0;
+	for (token_list t = tl; t != NULL; t = t->next)
+	{
+		n++;
+		switch (t->data.type)
+		{
+		case TOKEN_BRACKET_ARRAY_OPEN:
+		case TOKEN_BRACKET_OBJECT_OPEN:
+			depth++;
+			break;
+		case TOKEN_BRACKET_ARRAY_CLOSE:
+		case TOKEN_BRACKET_OBJECT_CLOSE:
+			if (depth > 0)
+				depth--;
+			break;
+		default:
+			break;
+		}
+		if (depth == 0)
+			break;
+	}
+	token_tape tape = {malloc(n * sizeof(token_t)), n, n};
+	if (tape.tokens == NULL)
+		return NULL;
+	token_list t = tl;
+	for (size_t i = 0; i < n; i++, t = t->next)
+		tape.tokens[i] = t->data;
+
+	size_t e;
+	syntax_tree s = parse_json_tape(&tape, &e);
+	// the root ends at the last packed token
 	if (s != NULL)
-		return s;
-	return NULL;
+		*end = t;
+	// string ownership may have been moved into the tree
+	t = tl;
+	for (size_t i = 0; i < n; i++, t = t->next)
+		t->data.flags = tape.tokens[i].flags;
+
+	free(tape.tokens);
+	return s;
 }
 
 syntax_tree *syntax_tree_first_child(syntax_tree root)
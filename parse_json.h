@@ -12,17 +12,28 @@
 #ifndef PARSE_JSON_H_INCLUDED
 #define PARSE_JSON_H_INCLUDED
 
+#include "arena_json.h"
 #include "lex_json.h"
 #include <stdio.h>
 
+#ifndef PARSE_JSON_MAX_DEPTH
+/** @brief The default maximal number of nested containers accepted by the parser */
+#define PARSE_JSON_MAX_DEPTH 1024
+#endif
+
+#ifndef SYNTAX_TREE_INDEX_THRESHOLD
+/** @brief The number of fields above which syntax_tree_get_field builds a hash index of the object */
+#define SYNTAX_TREE_INDEX_THRESHOLD 16
+#endif
+
 /** @brief Syntax tree element indentifiers */
 typedef enum
 {
 	syntax_string,
-	syntax_number,
+	syntax_number,	 // floating point number
+	syntax_integer,	 // integer that fits in int64_t
+	syntax_unsigned, // integer above INT64_MAX that fits in uint64_t
 	syntax_pair,
-	syntax_elements,
-	syntax_members,
 	syntax_array,
 	syntax_object,
 	syntax_true,
@@ -30,39 +41,275 @@ typedef enum
 	syntax_null
 } syntax_type_t;
 
+/** @brief Syntax tree node flags */
+enum
+{
+	SYNTAX_FLAG_OWNED = 1,	   ///<\brief the node owns the dynamically allocated string body
+	SYNTAX_FLAG_RAW_NUMBER = 2, ///<\brief the number node stores its text span, it is converted at the first access
+	SYNTAX_FLAG_ARENA = 4,		///<\brief the node, its children array and its string body are allocated in a document arena
+	SYNTAX_FLAG_INTERNED = 8,	///<\brief the key node refers to the single copy of its body in the key pool of its document
+	SYNTAX_FLAG_DICT = 16		///<\brief the string value node refers to the single copy of its body in the value dictionary of its document
+};
+
 /** @brief Tree type storing the syntax tree */
 typedef struct st
 {
 	syntax_type_t type;		///<\brief the tree node type
-	void *data;				///<\brief generic data stored in the tree node
-	struct st **children;	///<\brief array of pointers to children tree nodes
+	unsigned flags;			///<\brief the node flags
+	union
+	{
+		json_string string;	///<\brief the body of a string node, owned or a view into the input buffer, or the text of a raw number
+		double number;		///<\brief the value of a floating point number node
+		int64_t integer;	///<\brief the value of an integer node
+		uint64_t uinteger;	///<\brief the value of an unsigned integer node
+		struct
+		{
+			struct syntax_field_index *index; ///<\brief the field index or NULL if not built yet
+			struct json_document *document;	  ///<\brief the document owning the object or NULL for heap trees
+		} object;			///<\brief the lazily built field index of an object node
+	} data;					///<\brief data stored in the tree node tagged by the node type
+	struct st **children;	///<\brief NULL terminated array of pointers to children tree nodes
+	size_t num_children;	///<\brief the number of children nodes
+	size_t capacity;		///<\brief the number of allocated children slots without the terminator
 } syntax_tree_elem;
 typedef syntax_tree_elem *syntax_tree;	///<\brief the tree pointer and tree type
 
+/**
+ * @brief pool of the distinct object keys or string values of a document
+ * 
+ * The strings are stored once in the document arena and found through an open addressing hash table.
+ * Each string has a dense identifier, the number of strings interned before it.
+ */
+typedef struct
+{
+	struct json_intern_entry **slots; ///<\brief the hash table of the interned keys
+	size_t capacity;				  ///<\brief the number of slots, zero or a power of two
+	size_t size;					  ///<\brief the number of interned keys
+} json_intern_pool;
+
+/**
+ * @brief JSON document owning the memory of its syntax tree
+ * 
+ * The nodes, children arrays and decoded string bodies of the tree are carved from
+ * the arena of the document, so the tree is released at once by resetting or deleting
+ * the document. The nodes of a document are skipped by syntax_tree_delete and rejected
+ * by syntax_tree_add_child, syntax_tree_copy makes an independent copy.
+ * Each distinct object key is stored once, the key nodes share the interned body.
+ * String values are deduplicated the same way if the value dictionary is enabled.
+ */
+typedef struct json_document
+{
+	json_arena arena;		///<\brief the arena of the tree memory
+	json_intern_pool keys;	///<\brief the pool of the object keys
+	json_intern_pool values;	///<\brief the dictionary of the string values
+	int dictionary;			///<\brief nonzero if string values are stored in the dictionary
+	syntax_tree root;		///<\brief the root of the parsed tree or NULL
+	syntax_tree *stack;		///<\brief the scratch stack of the parser reused between parses
+	size_t stack_capacity;	///<\brief the number of allocated scratch stack slots
+	size_t *frames;			///<\brief the container stack of the parser reused between parses
+	size_t frames_capacity;	///<\brief the number of allocated container stack slots
+	size_t max_depth;		///<\brief the maximal number of nested containers
+} json_document;
+
 /**
  * @brief Parse a json file
  * 
+ * The parser is not recursive, it rejects input nested deeper than PARSE_JSON_MAX_DEPTH.
+ * 
  * @param tl Pointer to the token list
  * @param[out] end Pointer to the first uninterpreted element of the token list
  * @return The interpreted syntax tree or NULL if could not interpret
  */
 syntax_tree parse_json(token_list tl, token_list *end);
 
+/**
+ * @brief Parse a json token tape
+ * 
+ * Dynamically allocated string bodies are moved from the tokens into the tree,
+ * string views are shared with the tokens.
+ * 
+ * @param tape Pointer to the token tape
+ * @param[out] end Position of the first uninterpreted token of the tape
+ * @return The interpreted syntax tree or NULL if could not interpret
+ */
+syntax_tree parse_json_tape(token_tape *tape, size_t *end);
+
+/**
+ * @brief Lex and parse a character buffer in a single pass
+ * 
+ * The tokens are pulled from the lexer while building the tree, so no token list
+ * or tape is stored. With the LEX_ZERO_COPY and LEX_LAZY_NUMBERS flags the tree refers
+ * to the buffer, so the buffer must outlive the tree.
+ * 
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags
+ * @param[out] end The number of characters consumed by the root
+ * @return The interpreted syntax tree or NULL if could not read or interpret
+ */
+syntax_tree parse_json_from_buffer(char const *buf, size_t len, unsigned flags, size_t *end);
+
+/**
+ * @brief incremental parser fed with chunks of the input
+ * 
+ * Tokens split by a chunk boundary are carried over to the next chunk,
+ * so the chunks can be parsed as they are received.
+ */
+typedef struct json_stream json_stream;
+
+/**
+ * @brief Create an incremental parser
+ * 
+ * @param doc The document receiving the tree, its previous tree is released, or NULL for a heap allocated tree
+ * @return A newly allocated parser or NULL if could not allocate
+ */
+json_stream *json_stream_create(json_document *doc);
+
+/**
+ * @brief Feed the next chunk of the input to an incremental parser
+ * 
+ * Complete tokens are parsed at once, the chunk is not needed after the call.
+ * After an error the parser rejects all further chunks.
+ * 
+ * @param stream The parser
+ * @param chunk The characters of the chunk
+ * @param len The number of characters in the chunk
+ * @return 0 on success, -1 if the input read so far could not be read or interpreted
+ */
+int json_stream_feed(json_stream *stream, char const *chunk, size_t len);
+
+/**
+ * @brief Finish the input of an incremental parser
+ * 
+ * A heap allocated tree is owned by the caller, a document tree by the document.
+ * 
+ * @param stream The parser
+ * @return The interpreted syntax tree or NULL if the input is incomplete or could not be read or interpreted
+ */
+syntax_tree json_stream_finish(json_stream *stream);
+
+/**
+ * @brief Delete an incremental parser
+ * 
+ * The partially parsed tree of an unfinished input is released.
+ * 
+ * @param stream The parser
+ */
+void json_stream_delete(json_stream *stream);
+
+/**
+ * @brief Create an empty JSON document
+ * 
+ * @return A newly allocated document or NULL if could not allocate
+ */
+json_document *json_document_create(void);
+
+/**
+ * @brief Parse a json token tape into a document
+ * 
+ * The previous tree of the document is released. Dynamically allocated string bodies
+ * are copied into the document, string views and raw numbers are shared with the tokens,
+ * so the tape can be deleted after parsing.
+ * 
+ * @param doc The document
+ * @param tape Pointer to the token tape
+ * @param[out] end Position of the first uninterpreted token of the tape
+ * @return The root of the syntax tree or NULL if could not interpret
+ */
+syntax_tree json_document_parse_tape(json_document *doc, token_tape *tape, size_t *end);
+
+/**
+ * @brief Parse a json token tape into a document keeping its previous trees
+ * 
+ * The new tree shares the arena and the key pool with the trees parsed before,
+ * the root of the document becomes the new tree. Trees of malformed input are
+ * not released until the document is reset.
+ * 
+ * @param doc The document
+ * @param tape Pointer to the token tape
+ * @param[out] end Position of the first uninterpreted token of the tape
+ * @return The root of the new syntax tree or NULL if could not interpret
+ */
+syntax_tree json_document_append_tape(json_document *doc, token_tape *tape, size_t *end);
+
+/**
+ * @brief Lex and parse a character buffer into a document
+ * 
+ * With the LEX_ZERO_COPY and LEX_LAZY_NUMBERS flags the tree refers to the buffer,
+ * so the buffer must outlive the tree.
+ * 
+ * @param doc The document
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param flags Bitwise or of LEX_* flags
+ * @return The root of the syntax tree or NULL if could not read or interpret
+ */
+syntax_tree json_document_parse_buffer(json_document *doc, char const *buf, size_t len, unsigned flags);
+
+/**
+ * @brief Set the maximal nesting depth accepted by the parser of a document
+ * 
+ * @param doc The document
+ * @param max_depth The maximal number of nested containers, PARSE_JSON_MAX_DEPTH by default
+ * @return 0 on success, -1 if the depth is zero
+ */
+int json_document_set_max_depth(json_document *doc, size_t max_depth);
+
+/**
+ * @brief Enable or disable the value dictionary of a document
+ * 
+ * With the dictionary each distinct string value of the parsed tree is stored once,
+ * the string nodes share the body and get a dense identifier, see syntax_tree_get_string_id.
+ * It pays off for log shaped data repeating the same values in many records.
+ * The setting applies from the next parse, the dictionary is disabled by default.
+ * 
+ * @param doc The document
+ * @param enabled Nonzero to enable the dictionary
+ */
+void json_document_set_dictionary(json_document *doc, int enabled);
+
+/**
+ * @brief Release the tree of a document and keep its memory for the next parse
+ * 
+ * @param doc The document
+ */
+void json_document_reset(json_document *doc);
+
+/**
+ * @brief Delete a document and its tree
+ * 
+ * @param doc The document
+ */
+void json_document_delete(json_document *doc);
+
 /**
  * @brief Delete a syntax tree
  * 
+ * Trees owned by a document are left untouched.
+ * 
  * @param root The root pointer
  */
 void syntax_tree_delete(syntax_tree root);
 
 /**
  * @brief Add a child to a syntax tree node
- * The element is not copied, just linked as the last child
+ * The element is not copied, just linked as the last child.
+ * The children array grows geometrically, so appending is amortized O(1).
+ * Nodes owned by a document cannot be extended.
+ * 
+ * @param tree Pointer to the tree node
+ * @param child Pointer to the child node, still owned by the caller on failure
+ * @return 0 on success, -1 if the node is owned by a document or could not allocate
+ */
+int syntax_tree_add_child(syntax_tree tree, syntax_tree child);
+
+/**
+ * @brief Get the number of children of a syntax tree node
  * 
  * @param tree Pointer to the tree node
- * @param child Pointer to the child node
+ * @return The number of children nodes
  */
-void syntax_tree_add_child(syntax_tree tree, syntax_tree child);
+size_t syntax_tree_num_children(syntax_tree tree);
 
 /**
  * @brief Print a syntax tree to an ouput stream
@@ -96,9 +343,57 @@ syntax_tree *syntax_tree_first_child(syntax_tree root);
  */
 syntax_tree *syntax_tree_next_sibling(syntax_tree *child);
 
+/**
+ * @brief Get the value of a number node as a double
+ * 
+ * Integer nodes are converted to the nearest double.
+ * The number accessors convert raw number nodes parsed with the LEX_LAZY_NUMBERS
+ * flag at the first access and cache the result in the node.
+ * 
+ * @param node Pointer to the syntax tree node
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the node is not a number
+ */
+int syntax_tree_get_double(syntax_tree node, double *value);
+
+/**
+ * @brief Get the value of a number node as a signed 64 bit integer
+ * 
+ * @param node Pointer to the syntax tree node
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the node is not a number or its value is not an integer in the range of int64_t
+ */
+int syntax_tree_get_int64(syntax_tree node, int64_t *value);
+
+/**
+ * @brief Get the value of a number node as an unsigned 64 bit integer
+ * 
+ * @param node Pointer to the syntax tree node
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the node is not a number or its value is not an integer in the range of uint64_t
+ */
+int syntax_tree_get_uint64(syntax_tree node, uint64_t *value);
+
+/**
+ * @brief Get the dictionary identifier of a string node
+ * 
+ * Equal string values of a document parsed with the value dictionary have equal identifiers,
+ * the identifiers are dense from 0 in the order of the first occurrence of the values.
+ * 
+ * @param node Pointer to the syntax tree node
+ * @param[out] id The identifier of the string value
+ * @return 0 on success, -1 if the node is not a string value stored in a dictionary
+ */
+int syntax_tree_get_string_id(syntax_tree node, size_t *id);
+
 /**
  * @brief Get a specific field of and object node
  * 
+ * Objects with at least SYNTAX_TREE_INDEX_THRESHOLD fields are searched through a seeded
+ * hash index built at the first lookup, smaller objects are scanned. The keys of document
+ * trees are compared by their interned address. Building the index
+ * modifies the object, so concurrent lookups in the same tree must be synchronized.
+ * 
  * @param object Pointer to the syntax tree node
  * @param fieldname The searched field name
  * @return Pointer to the value node or NULL if the field does not exist
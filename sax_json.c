@@ -0,0 +1,273 @@
+/**
+ * @file sax_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the event parser
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "sax_json.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief grammar states of the event parser
+ */
+enum
+{
+	SAX_ROOT,			  ///<\brief the root container
+	SAX_VALUE,			  ///<\brief a value after a colon or an array comma
+	SAX_VALUE_OR_CLOSE,	  ///<\brief the first element of an array or its closing bracket
+	SAX_KEY_OR_CLOSE,	  ///<\brief the first key of an object or its closing brace
+	SAX_KEY,			  ///<\brief a key after an object comma
+	SAX_COLON,			  ///<\brief the colon after a key
+	SAX_COMMA_OR_CLOSE,	  ///<\brief a comma or the closing bracket after a child
+	SAX_DONE			  ///<\brief the root is closed
+};
+
+/**
+ * @brief state of the event parser
+ *
+ * The open containers are stored on a bit stack, the bit of a container is set for objects.
+ * Escaped strings are decoded into the scratch buffer, grown to the longest one.
+ */
+typedef struct
+{
+	json_sax_handler const *h;						  ///<\brief the callbacks
+	void *ctx;										  ///<\brief the context pointer of the callbacks
+	uint64_t nesting[(JSON_SAX_MAX_DEPTH + 63) / 64]; ///<\brief the bit stack of the open containers
+	size_t depth;									  ///<\brief the number of open containers
+	int state;										  ///<\brief the grammar state
+	char *scratch;									  ///<\brief the decoded body of the last escaped string
+	size_t scratch_capacity;						  ///<\brief the number of allocated scratch characters
+} sax_state;
+
+/**
+ * @brief Get the body of a string token
+ *
+ * @param s The parser state
+ * @param tok The string token
+ * @param[out] str The body, a view into the buffer or the decoded string in the scratch buffer
+ * @return 0 on success, -1 if the escape sequences are invalid or could not allocate
+ */
+static int sax_string(sax_state *s, token_t const *tok, json_string *str)
+{
+	*str = tok->value.string;
+	if (!(tok->flags & TOKEN_FLAG_ESCAPED))
+		return 0;
+	if (s->scratch_capacity < str->len + 1)
+	{
+		size_t capacity = 2 * s->scratch_capacity > str->len + 1 ? 2 * s->scratch_capacity : str->len + 1;
+		char *scratch = realloc(s->scratch, capacity);
+		if (scratch == NULL)
+			return -1;
+		s->scratch = scratch;
+		s->scratch_capacity = capacity;
+	}
+	ptrdiff_t n = json_string_decode(*str, s->scratch);
+	if (n < 0)
+		return -1;
+	s->scratch[n] = '\0';
+	str->ptr = s->scratch;
+	str->len = n;
+	return 0;
+}
+
+/**
+ * @brief Check if the innermost open container is an object
+ *
+ * @param s The parser state
+ * @return Nonzero for an object, zero for an array
+ */
+static int sax_in_object(sax_state const *s)
+{
+	size_t top = s->depth - 1;
+	return (s->nesting[top / 64] >> (top % 64)) & 1;
+}
+
+/**
+ * @brief Move to the state after a complete value
+ *
+ * @param s The parser state
+ */
+static void sax_value_done(sax_state *s)
+{
+	s->state = s->depth == 0 ? SAX_DONE : SAX_COMMA_OR_CLOSE;
+}
+
+/**
+ * @brief Open a container
+ *
+ * @param s The parser state
+ * @param object Nonzero for an object, zero for an array
+ * @return 0 on success, -1 if the depth limit is exceeded or the callback stopped parsing
+ */
+static int sax_open(sax_state *s, int object)
+{
+	if (s->depth >= JSON_SAX_MAX_DEPTH)
+		return -1;
+	uint64_t bit = UINT64_C(1) << (s->depth % 64);
+	if (object)
+		s->nesting[s->depth / 64] |= bit;
+	else
+		s->nesting[s->depth / 64] &= ~bit;
+	s->depth++;
+	s->state = object ? SAX_KEY_OR_CLOSE : SAX_VALUE_OR_CLOSE;
+	int (*cb)(void *) = object ? s->h->start_object : s->h->start_array;
+	return cb != NULL && cb(s->ctx) != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Close the innermost container
+ *
+ * @param s The parser state
+ * @param object Nonzero for a closing brace, zero for a closing bracket
+ * @return 0 on success, -1 if the bracket does not match or the callback stopped parsing
+ */
+static int sax_close(sax_state *s, int object)
+{
+	if (sax_in_object(s) != (object != 0))
+		return -1;
+	s->depth--;
+	sax_value_done(s);
+	int (*cb)(void *) = object ? s->h->end_object : s->h->end_array;
+	return cb != NULL && cb(s->ctx) != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Process a value token
+ *
+ * @param s The parser state
+ * @param tok The token
+ * @return 0 on success, -1 if the token is not a value or the callback stopped parsing
+ */
+static int sax_value(sax_state *s, token_t const *tok)
+{
+	json_sax_handler const *h = s->h;
+	json_string str;
+	int stop;
+	switch (tok->type)
+	{
+	case TOKEN_BRACKET_ARRAY_OPEN:
+		return sax_open(s, 0);
+	case TOKEN_BRACKET_OBJECT_OPEN:
+		return sax_open(s, 1);
+	case TOKEN_STRING:
+		if (sax_string(s, tok, &str) != 0)
+			return -1;
+		stop = h->string != NULL && h->string(s->ctx, str) != 0;
+		break;
+	case TOKEN_NUMBER:
+		stop = h->number != NULL && h->number(s->ctx, tok->value.number) != 0;
+		break;
+	case TOKEN_INTEGER:
+		stop = h->integer != NULL && h->integer(s->ctx, tok->value.integer) != 0;
+		break;
+	case TOKEN_UNSIGNED:
+		stop = h->uinteger != NULL && h->uinteger(s->ctx, tok->value.uinteger) != 0;
+		break;
+	case TOKEN_TRUE:
+		stop = h->boolean != NULL && h->boolean(s->ctx, 1) != 0;
+		break;
+	case TOKEN_FALSE:
+		stop = h->boolean != NULL && h->boolean(s->ctx, 0) != 0;
+		break;
+	case TOKEN_NULL:
+		stop = h->null != NULL && h->null(s->ctx) != 0;
+		break;
+	default:
+		return -1;
+	}
+	sax_value_done(s);
+	return stop ? -1 : 0;
+}
+
+/**
+ * @brief Process a key token
+ *
+ * @param s The parser state
+ * @param tok The token
+ * @return 0 on success, -1 if the token is not a string or the callback stopped parsing
+ */
+static int sax_key(sax_state *s, token_t const *tok)
+{
+	json_string str;
+	if (tok->type != TOKEN_STRING || sax_string(s, tok, &str) != 0)
+		return -1;
+	s->state = SAX_COLON;
+	return s->h->key != NULL && s->h->key(s->ctx, str) != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Process the next token
+ *
+ * @param s The parser state
+ * @param tok The token
+ * @return 0 on success, -1 if the token could not be interpreted or a callback stopped parsing
+ */
+static int sax_step(sax_state *s, token_t const *tok)
+{
+	switch (s->state)
+	{
+	case SAX_ROOT:
+		if (tok->type != TOKEN_BRACKET_ARRAY_OPEN && tok->type != TOKEN_BRACKET_OBJECT_OPEN)
+			return -1;
+		return sax_value(s, tok);
+	case SAX_VALUE:
+		return sax_value(s, tok);
+	case SAX_VALUE_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_ARRAY_CLOSE)
+			return sax_close(s, 0);
+		return sax_value(s, tok);
+	case SAX_KEY_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_OBJECT_CLOSE)
+			return sax_close(s, 1);
+		return sax_key(s, tok);
+	case SAX_KEY:
+		return sax_key(s, tok);
+	case SAX_COLON:
+		if (tok->type != TOKEN_PUNCTUATOR_COLON)
+			return -1;
+		s->state = SAX_VALUE;
+		return 0;
+	case SAX_COMMA_OR_CLOSE:
+		switch (tok->type)
+		{
+		case TOKEN_PUNCTUATOR_COMMA:
+			s->state = sax_in_object(s) ? SAX_KEY : SAX_VALUE;
+			return 0;
+		case TOKEN_BRACKET_ARRAY_CLOSE:
+			return sax_close(s, 0);
+		case TOKEN_BRACKET_OBJECT_CLOSE:
+			return sax_close(s, 1);
+		default:
+			return -1;
+		}
+	default:
+		// trailing token after the root
+		return -1;
+	}
+}
+
+int json_sax_parse(char const *buf, size_t len, json_sax_handler const *h, void *ctx)
+{
+	// string tokens are views into the buffer, escaped ones are decoded by the parser
+	json_lexer lexer;
+	json_lexer_init(&lexer, buf, len, LEX_ZERO_COPY | LEX_RAW_ESCAPES);
+	sax_state s;
+	s.h = h;
+	s.ctx = ctx;
+	s.depth = 0;
+	s.state = SAX_ROOT;
+	s.scratch = NULL;
+	s.scratch_capacity = 0;
+
+	token_t tok;
+	int status;
+	while ((status = json_lexer_next(&lexer, &tok)) == 1 && sax_step(&s, &tok) == 0)
+		;
+	free(s.scratch);
+	return status == 0 && s.state == SAX_DONE ? 0 : -1;
+}
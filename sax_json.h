@@ -0,0 +1,63 @@
+/**
+ * @file sax_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief event callback parsing of JSON buffers
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef SAX_JSON_H_INCLUDED
+#define SAX_JSON_H_INCLUDED
+
+#include "lex_json.h"
+#include <stdint.h>
+
+#ifndef JSON_SAX_MAX_DEPTH
+/** @brief The maximal number of nested containers accepted by the event parser */
+#define JSON_SAX_MAX_DEPTH 1024
+#endif
+
+/**
+ * @brief callbacks of the event parser
+ *
+ * Each callback gets the context pointer passed to json_sax_parse and returns 0 to continue
+ * or nonzero to stop parsing. NULL callbacks are skipped. String bodies are only valid
+ * during the callback, they are views into the buffer unless they contain escapes,
+ * those are decoded into a zero terminated buffer owned by the parser and reused for the next one.
+ */
+typedef struct
+{
+	int (*start_object)(void *ctx);						///<\brief an object is opened
+	int (*end_object)(void *ctx);						///<\brief the innermost object is closed
+	int (*start_array)(void *ctx);						///<\brief an array is opened
+	int (*end_array)(void *ctx);						///<\brief the innermost array is closed
+	int (*key)(void *ctx, json_string key);				///<\brief an object key, its value follows
+	int (*string)(void *ctx, json_string value);		///<\brief a string value
+	int (*number)(void *ctx, double value);				///<\brief a floating point number
+	int (*integer)(void *ctx, int64_t value);			///<\brief an integer that fits in int64_t
+	int (*uinteger)(void *ctx, uint64_t value);			///<\brief an integer above INT64_MAX
+	int (*boolean)(void *ctx, int value);				///<\brief true or false
+	int (*null)(void *ctx);								///<\brief null
+} json_sax_handler;
+
+/**
+ * @brief Parse a character buffer firing the callbacks of a handler
+ *
+ * The tokens are pulled from the lexer and reported directly, no tree is built.
+ * The only allocation is the scratch buffer of the escaped strings, grown to the longest one.
+ * The nesting of the containers is tracked on a bit stack of fixed size, so the parser
+ * rejects input nested deeper than JSON_SAX_MAX_DEPTH. The root is an array or an object,
+ * trailing tokens are an error. Callbacks may have been fired before an error is found.
+ *
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @param h The callbacks
+ * @param ctx The context pointer passed to the callbacks
+ * @return 0 on success, -1 if the input could not be read or interpreted or a callback stopped parsing
+ */
+int json_sax_parse(char const *buf, size_t len, json_sax_handler const *h, void *ctx);
+
+#endif // SAX_JSON_H_INCLUDED
@@ -0,0 +1,627 @@
+/**
+ * @file tape_json.c
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief implementation of the tape document
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include "tape_json.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAYLOAD_MASK ((UINT64_C(1) << 56) - 1) ///<\brief the payload bits of a tape word
+
+/**
+ * @brief grammar states of the tape builder
+ */
+enum
+{
+	EXPECT_VALUE,			 ///<\brief a value after a colon or an array comma
+	EXPECT_VALUE_OR_CLOSE,	 ///<\brief the first element of an array or its end
+	EXPECT_KEY,				 ///<\brief a key after an object comma
+	EXPECT_KEY_OR_CLOSE,	 ///<\brief the first key of an object or its end
+	EXPECT_COLON,			 ///<\brief the colon after a key
+	EXPECT_COMMA_OR_CLOSE	 ///<\brief a comma or the end of the container after a value
+};
+
+/**
+ * @brief state of the tape builder
+ */
+typedef struct
+{
+	json_tape *tape; ///<\brief the tape being built
+	size_t *stack;	 ///<\brief the positions of the open containers
+	size_t depth;	 ///<\brief the number of open containers
+	size_t capacity; ///<\brief the number of allocated stack slots
+	int state;		 ///<\brief the grammar state
+} tape_builder;
+
+/**
+ * @brief Create a tape word
+ *
+ * @param type The word type
+ * @param payload The 56 bit payload
+ * @return The tape word
+ */
+static uint64_t tape_word(json_tape_type_t type, uint64_t payload)
+{
+	return (uint64_t)type << 56 | payload;
+}
+
+/**
+ * @brief Get the payload of a tape word
+ *
+ * @param tape The tape
+ * @param pos The position of the word
+ * @return The 56 bit payload
+ */
+static size_t tape_payload(json_tape const *tape, size_t pos)
+{
+	return (size_t)(tape->words[pos] & PAYLOAD_MASK);
+}
+
+/**
+ * @brief Make room for words on the tape
+ *
+ * @param tape The tape
+ * @param n The number of words to add
+ * @return 0 on success, -1 if could not allocate
+ */
+static int tape_reserve(json_tape *tape, size_t n)
+{
+	if (tape->capacity - tape->size >= n)
+		return 0;
+	size_t capacity = tape->capacity == 0 ? 1024 : tape->capacity;
+	while (capacity - tape->size < n)
+		capacity *= 2;
+	uint64_t *words = realloc(tape->words, capacity * sizeof(uint64_t));
+	if (words == NULL)
+		return -1;
+	tape->words = words;
+	tape->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief Append a string to the string buffer
+ *
+ * @param tape The tape
+ * @param str The string
+ * @param[out] offset The offset of the stored string
+ * @return 0 on success, -1 if could not allocate
+ */
+static int tape_add_string(json_tape *tape, json_string str, size_t *offset)
+{
+	uint64_t len = str.len;
+	size_t n = sizeof(len) + str.len + 1;
+	if (tape->strings_capacity - tape->strings_size < n)
+	{
+		size_t capacity = tape->strings_capacity == 0 ? 4096 : tape->strings_capacity;
+		while (capacity - tape->strings_size < n)
+			capacity *= 2;
+		char *strings = realloc(tape->strings, capacity);
+		if (strings == NULL)
+			return -1;
+		tape->strings = strings;
+		tape->strings_capacity = capacity;
+	}
+	*offset = tape->strings_size;
+	char *p = tape->strings + tape->strings_size;
+	memcpy(p, &len, sizeof(len));
+	memcpy(p + sizeof(len), str.ptr, str.len);
+	p[sizeof(len) + str.len] = '\0';
+	tape->strings_size += n;
+	return 0;
+}
+
+/**
+ * @brief Append a scalar token to the tape
+ *
+ * Raw numbers are converted.
+ *
+ * @param tape The tape
+ * @param tok The scalar token
+ * @param type The word type of string tokens
+ * @return 0 on success, -1 if the token is not a scalar or could not allocate
+ */
+static int tape_add_scalar(json_tape *tape, token_t const *tok, json_tape_type_t type)
+{
+	token_t num;
+	size_t offset;
+	switch (tok->type)
+	{
+	case TOKEN_STRING:
+		if (tape_add_string(tape, tok->value.string, &offset) != 0)
+			return -1;
+		tape->words[tape->size++] = tape_word(type, offset);
+		return 0;
+	case TOKEN_NUMBER:
+	case TOKEN_INTEGER:
+	case TOKEN_UNSIGNED:
+		num = *tok;
+		if (token_materialize_number(&num) != 0)
+			return -1;
+		type = num.type == TOKEN_INTEGER ? JSON_TAPE_INTEGER : num.type == TOKEN_UNSIGNED ? JSON_TAPE_UNSIGNED : JSON_TAPE_NUMBER;
+		tape->words[tape->size++] = tape_word(type, 0);
+		// the number value is stored in the next word with the same 64 bits
+		tape->words[tape->size++] = num.value.uinteger;
+		return 0;
+	case TOKEN_TRUE:
+		tape->words[tape->size++] = tape_word(JSON_TAPE_TRUE, 0);
+		return 0;
+	case TOKEN_FALSE:
+		tape->words[tape->size++] = tape_word(JSON_TAPE_FALSE, 0);
+		return 0;
+	case TOKEN_NULL:
+		tape->words[tape->size++] = tape_word(JSON_TAPE_NULL, 0);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+void json_tape_init(json_tape *tape)
+{
+	tape->words = NULL;
+	tape->size = 0;
+	tape->capacity = 0;
+	tape->strings = NULL;
+	tape->strings_size = 0;
+	tape->strings_capacity = 0;
+	tape->max_depth = JSON_TAPE_MAX_DEPTH;
+}
+
+int json_tape_set_max_depth(json_tape *tape, size_t max_depth)
+{
+	if (max_depth == 0)
+		return -1;
+	tape->max_depth = max_depth;
+	return 0;
+}
+
+/**
+ * @brief Open a container on the tape
+ *
+ * @param b The tape builder
+ * @param array Nonzero for an array, zero for an object
+ * @return 0 on success, -1 if the nesting is deeper than the maximal depth of the tape or could not allocate
+ */
+static int builder_open(tape_builder *b, int array)
+{
+	if (b->depth == b->tape->max_depth)
+		return -1;
+	if (b->depth == b->capacity)
+	{
+		size_t capacity = b->capacity == 0 ? 64 : 2 * b->capacity;
+		size_t *stack = realloc(b->stack, capacity * sizeof(size_t));
+		if (stack == NULL)
+			return -1;
+		b->stack = stack;
+		b->capacity = capacity;
+	}
+	json_tape *tape = b->tape;
+	b->stack[b->depth++] = tape->size;
+	// the payload is patched when the container is closed
+	tape->words[tape->size++] = tape_word(array ? JSON_TAPE_ARRAY : JSON_TAPE_OBJECT, 0);
+	b->state = array ? EXPECT_VALUE_OR_CLOSE : EXPECT_KEY_OR_CLOSE;
+	return 0;
+}
+
+/**
+ * @brief Close the innermost container on the tape
+ *
+ * @param b The tape builder
+ * @param type The closing bracket token
+ * @return 0 on success, -1 if the bracket does not match the container
+ */
+static int builder_close(tape_builder *b, token_type_t type)
+{
+	json_tape *tape = b->tape;
+	size_t open = b->stack[b->depth - 1];
+	int array = json_tape_type(tape, open) == JSON_TAPE_ARRAY;
+	if (array != (type == TOKEN_BRACKET_ARRAY_CLOSE))
+		return -1;
+	b->depth--;
+	tape->words[open] |= tape->size;
+	tape->words[tape->size++] = tape_word(array ? JSON_TAPE_ARRAY_END : JSON_TAPE_OBJECT_END, open);
+	b->state = EXPECT_COMMA_OR_CLOSE;
+	return 0;
+}
+
+/**
+ * @brief Append a value token to the tape
+ *
+ * @param b The tape builder
+ * @param tok The token
+ * @return 0 on success, -1 if the token is not a value
+ */
+static int builder_value(tape_builder *b, token_t const *tok)
+{
+	switch (tok->type)
+	{
+	case TOKEN_BRACKET_ARRAY_OPEN:
+		return builder_open(b, 1);
+	case TOKEN_BRACKET_OBJECT_OPEN:
+		return builder_open(b, 0);
+	default:
+		b->state = EXPECT_COMMA_OR_CLOSE;
+		return tape_add_scalar(b->tape, tok, JSON_TAPE_STRING);
+	}
+}
+
+/**
+ * @brief Process the next token of the tape builder
+ *
+ * @param b The tape builder
+ * @param tok The token
+ * @return 0 on success, -1 if the token could not be interpreted
+ */
+static int builder_step(tape_builder *b, token_t const *tok)
+{
+	switch (b->state)
+	{
+	case EXPECT_VALUE:
+		return builder_value(b, tok);
+	case EXPECT_VALUE_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_ARRAY_CLOSE)
+			return builder_close(b, tok->type);
+		return builder_value(b, tok);
+	case EXPECT_KEY_OR_CLOSE:
+		if (tok->type == TOKEN_BRACKET_OBJECT_CLOSE)
+			return builder_close(b, tok->type);
+		if (tok->type != TOKEN_STRING)
+			return -1;
+		b->state = EXPECT_COLON;
+		return tape_add_scalar(b->tape, tok, JSON_TAPE_KEY);
+	case EXPECT_KEY:
+		if (tok->type != TOKEN_STRING)
+			return -1;
+		b->state = EXPECT_COLON;
+		return tape_add_scalar(b->tape, tok, JSON_TAPE_KEY);
+	case EXPECT_COLON:
+		if (tok->type != TOKEN_PUNCTUATOR_COLON)
+			return -1;
+		b->state = EXPECT_VALUE;
+		return 0;
+	case EXPECT_COMMA_OR_CLOSE:
+		if (tok->type == TOKEN_PUNCTUATOR_COMMA)
+		{
+			b->state = json_tape_type(b->tape, b->stack[b->depth - 1]) == JSON_TAPE_OBJECT ? EXPECT_KEY : EXPECT_VALUE;
+			return 0;
+		}
+		if (tok->type != TOKEN_BRACKET_ARRAY_CLOSE && tok->type != TOKEN_BRACKET_OBJECT_CLOSE)
+			return -1;
+		return builder_close(b, tok->type);
+	default:
+		return -1;
+	}
+}
+
+int json_tape_build(json_tape *tape, token_tape const *tokens, size_t *end)
+{
+	*end = 0;
+	tape->size = 0;
+	tape->strings_size = 0;
+	if (tokens->size == 0)
+		return -1;
+	token_type_t root = tokens->tokens[0].type;
+	if (root != TOKEN_BRACKET_ARRAY_OPEN && root != TOKEN_BRACKET_OBJECT_OPEN)
+		return -1;
+	// each token produces at most two words
+	if (tokens->size > SIZE_MAX / 2 / sizeof(uint64_t) || tape_reserve(tape, 2 * tokens->size) != 0)
+		return -1;
+
+	tape_builder b = {tape, NULL, 0, 0, EXPECT_VALUE};
+	int status = -1;
+	for (size_t pos = 0; pos < tokens->size; pos++)
+	{
+		if (builder_step(&b, &tokens->tokens[pos]) != 0)
+			break;
+		if (b.depth == 0)
+		{
+			// the root is closed
+			*end = pos + 1;
+			status = 0;
+			break;
+		}
+	}
+	free(b.stack);
+	if (status != 0)
+		tape->size = 0;
+	return status;
+}
+
+int json_tape_build_from_buffer(json_tape *tape, char const *buf, size_t len)
+{
+	// the strings are copied into the string buffer, so the tokens may refer to the buffer
+	token_tape *tokens = token_tape_read_from_buffer(buf, len, LEX_ZERO_COPY);
+	if (tokens == NULL)
+		return -1;
+	size_t end;
+	int status = json_tape_build(tape, tokens, &end);
+	if (status == 0 && end != tokens->size)
+	{
+		tape->size = 0;
+		status = -1;
+	}
+	token_tape_delete(tokens);
+	return status;
+}
+
+void json_tape_free(json_tape *tape)
+{
+	free(tape->words);
+	free(tape->strings);
+	json_tape_init(tape);
+}
+
+json_tape_type_t json_tape_type(json_tape const *tape, size_t pos)
+{
+	return (json_tape_type_t)(tape->words[pos] >> 56);
+}
+
+/**
+ * @brief Get the position after a value
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @return The position of the word after the value
+ */
+static size_t tape_skip(json_tape const *tape, size_t pos)
+{
+	switch (json_tape_type(tape, pos))
+	{
+	case JSON_TAPE_ARRAY:
+	case JSON_TAPE_OBJECT:
+		return tape_payload(tape, pos) + 1;
+	case JSON_TAPE_NUMBER:
+	case JSON_TAPE_INTEGER:
+	case JSON_TAPE_UNSIGNED:
+		return pos + 2;
+	case JSON_TAPE_KEY:
+		// a key is skipped together with its value
+		return tape_skip(tape, pos + 1);
+	default:
+		return pos + 1;
+	}
+}
+
+size_t json_tape_first_child(json_tape const *tape, size_t pos)
+{
+	json_tape_type_t type = json_tape_type(tape, pos);
+	if (type != JSON_TAPE_ARRAY && type != JSON_TAPE_OBJECT)
+		return 0;
+	return tape_payload(tape, pos) == pos + 1 ? 0 : pos + 1;
+}
+
+size_t json_tape_next_sibling(json_tape const *tape, size_t pos)
+{
+	size_t next = tape_skip(tape, pos);
+	if (next >= tape->size)
+		return 0;
+	json_tape_type_t type = json_tape_type(tape, next);
+	return type == JSON_TAPE_ARRAY_END || type == JSON_TAPE_OBJECT_END ? 0 : next;
+}
+
+size_t json_tape_key_value(json_tape const *tape, size_t pos)
+{
+	return pos + 1;
+}
+
+size_t json_tape_get_field(json_tape const *tape, size_t pos, char const *fieldname)
+{
+	if (json_tape_type(tape, pos) != JSON_TAPE_OBJECT)
+		return 0;
+	size_t len = strlen(fieldname);
+	for (size_t key = json_tape_first_child(tape, pos); key != 0; key = json_tape_next_sibling(tape, key))
+	{
+		json_string name = {NULL, 0};
+		json_tape_get_string(tape, key, &name);
+		if (name.len == len && memcmp(name.ptr, fieldname, len) == 0)
+			return json_tape_key_value(tape, key);
+	}
+	return 0;
+}
+
+int json_tape_get_string(json_tape const *tape, size_t pos, json_string *value)
+{
+	json_tape_type_t type = json_tape_type(tape, pos);
+	if (type != JSON_TAPE_STRING && type != JSON_TAPE_KEY)
+		return -1;
+	char const *p = tape->strings + tape_payload(tape, pos);
+	uint64_t len;
+	memcpy(&len, p, sizeof(len));
+	value->ptr = p + sizeof(len);
+	value->len = (size_t)len;
+	return 0;
+}
+
+int json_tape_get_double(json_tape const *tape, size_t pos, double *value)
+{
+	uint64_t bits = pos + 1 < tape->size ? tape->words[pos + 1] : 0;
+	switch (json_tape_type(tape, pos))
+	{
+	case JSON_TAPE_NUMBER:
+		memcpy(value, &bits, sizeof(bits));
+		return 0;
+	case JSON_TAPE_INTEGER:
+		*value = (double)(int64_t)bits;
+		return 0;
+	case JSON_TAPE_UNSIGNED:
+		*value = (double)bits;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+int json_tape_get_int64(json_tape const *tape, size_t pos, int64_t *value)
+{
+	double d;
+	switch (json_tape_type(tape, pos))
+	{
+	case JSON_TAPE_INTEGER:
+		*value = (int64_t)tape->words[pos + 1];
+		return 0;
+	case JSON_TAPE_NUMBER:
+		json_tape_get_double(tape, pos, &d);
+		// the range limits are powers of two, so they are exact doubles
+		if (!(d >= -0x1p63 && d < 0x1p63) || d != (double)(int64_t)d)
+			return -1;
+		*value = (int64_t)d;
+		return 0;
+	default:
+		// unsigned numbers are always above INT64_MAX
+		return -1;
+	}
+}
+
+int json_tape_get_uint64(json_tape const *tape, size_t pos, uint64_t *value)
+{
+	double d;
+	switch (json_tape_type(tape, pos))
+	{
+	case JSON_TAPE_UNSIGNED:
+		*value = tape->words[pos + 1];
+		return 0;
+	case JSON_TAPE_INTEGER:
+		if ((int64_t)tape->words[pos + 1] < 0)
+			return -1;
+		*value = tape->words[pos + 1];
+		return 0;
+	case JSON_TAPE_NUMBER:
+		json_tape_get_double(tape, pos, &d);
+		if (!(d >= 0.0 && d < 0x1p64) || d != (double)(uint64_t)d)
+			return -1;
+		*value = (uint64_t)d;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/**
+ * @brief open container of the tape printer
+ */
+typedef struct
+{
+	size_t end;	  ///<\brief the position of the end word of the container
+	int object;	  ///<\brief nonzero for an object
+	int indent;	  ///<\brief the indentation depth of the container
+} tape_print_frame;
+
+/**
+ * @brief Print a value without its children
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @param fout Output stream
+ * @param depth The indentation depth
+ */
+static void json_tape_print_value(json_tape const *tape, size_t pos, FILE *fout, int depth)
+{
+	for (int i = 0; i < depth; i++)
+		fputc('\t', fout);
+	json_string str;
+	double d;
+	switch (json_tape_type(tape, pos))
+	{
+	case JSON_TAPE_OBJECT:
+		fprintf(fout, "OBJECT: \n");
+		return;
+	case JSON_TAPE_ARRAY:
+		fprintf(fout, "ARRAY: \n");
+		return;
+	case JSON_TAPE_KEY:
+	case JSON_TAPE_STRING:
+		json_tape_get_string(tape, pos, &str);
+		fprintf(fout, "STRING:  %.*s", (int)str.len, str.ptr);
+		break;
+	case JSON_TAPE_NUMBER:
+		json_tape_get_double(tape, pos, &d);
+		fprintf(fout, "NUMBER:  %f", d);
+		break;
+	case JSON_TAPE_INTEGER:
+		fprintf(fout, "INTEGER:  %" PRId64, (int64_t)tape->words[pos + 1]);
+		break;
+	case JSON_TAPE_UNSIGNED:
+		fprintf(fout, "INTEGER:  %" PRIu64, tape->words[pos + 1]);
+		break;
+	case JSON_TAPE_TRUE:
+		fprintf(fout, "TRUE");
+		break;
+	case JSON_TAPE_FALSE:
+		fprintf(fout, "FALSE");
+		break;
+	case JSON_TAPE_NULL:
+		fprintf(fout, "NULL");
+		break;
+	default:
+		break;
+	}
+	fputc('\n', fout);
+}
+
+void json_tape_print(json_tape const *tape, FILE *fout)
+{
+	// the tape is walked in order, the open containers are kept on a heap stack
+	tape_print_frame *stack = NULL;
+	size_t depth = 0;
+	size_t capacity = 0;
+	size_t pos = 0;
+	while (pos < tape->size)
+	{
+		tape_print_frame *parent = depth > 0 ? &stack[depth - 1] : NULL;
+		if (parent != NULL && pos == parent->end)
+		{
+			// the end word of the innermost container
+			depth--;
+			pos++;
+			continue;
+		}
+		int indent = 0;
+		if (parent != NULL && !parent->object)
+			indent = parent->indent + 1;
+		else if (parent != NULL)
+		{
+			indent = parent->indent + 2;
+			if (json_tape_type(tape, pos) == JSON_TAPE_KEY)
+			{
+				for (int i = 0; i <= parent->indent; i++)
+					fputc('\t', fout);
+				fprintf(fout, "PAIR: \n");
+			}
+		}
+		json_tape_print_value(tape, pos, fout, indent);
+
+		json_tape_type_t type = json_tape_type(tape, pos);
+		if (type != JSON_TAPE_ARRAY && type != JSON_TAPE_OBJECT)
+		{
+			// a key is printed alone, its value is the next word
+			pos = type == JSON_TAPE_KEY ? pos + 1 : tape_skip(tape, pos);
+			if (depth == 0)
+				break;
+			continue;
+		}
+		if (depth == capacity)
+		{
+			size_t n = capacity == 0 ? 64 : 2 * capacity;
+			tape_print_frame *frames = realloc(stack, n * sizeof(tape_print_frame));
+			if (frames == NULL)
+				break;
+			stack = frames;
+			capacity = n;
+		}
+		stack[depth].end = tape_payload(tape, pos);
+		stack[depth].object = type == JSON_TAPE_OBJECT;
+		stack[depth].indent = indent;
+		depth++;
+		pos++;
+	}
+	free(stack);
+}
@@ -0,0 +1,210 @@
+/**
+ * @file tape_json.h
+ * @author Peter Fiala (fiala@hit.bme.hu)
+ * @brief compact read-only JSON document stored on a word tape
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef TAPE_JSON_H_INCLUDED
+#define TAPE_JSON_H_INCLUDED
+
+#include "lex_json.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef JSON_TAPE_MAX_DEPTH
+#define JSON_TAPE_MAX_DEPTH 1024 ///<\brief the default maximal number of nested containers of a tape
+#endif
+
+/**
+ * @brief tape word type identifiers
+ */
+typedef enum
+{
+	JSON_TAPE_ARRAY = '[',		///<\brief array start, the payload is the position of the matching end
+	JSON_TAPE_ARRAY_END = ']',	///<\brief array end, the payload is the position of the matching start
+	JSON_TAPE_OBJECT = '{',		///<\brief object start, the payload is the position of the matching end
+	JSON_TAPE_OBJECT_END = '}', ///<\brief object end, the payload is the position of the matching start
+	JSON_TAPE_KEY = ':',		///<\brief object key, the payload is the offset of the string in the string buffer
+	JSON_TAPE_STRING = '"',		///<\brief string, the payload is the offset of the string in the string buffer
+	JSON_TAPE_NUMBER = 'd',		///<\brief floating point number, the value is stored in the next word
+	JSON_TAPE_INTEGER = 'l',	///<\brief integer that fits in int64_t, the value is stored in the next word
+	JSON_TAPE_UNSIGNED = 'u',	///<\brief integer above INT64_MAX, the value is stored in the next word
+	JSON_TAPE_TRUE = 't',
+	JSON_TAPE_FALSE = 'f',
+	JSON_TAPE_NULL = 'n'
+} json_tape_type_t;
+
+/**
+ * @brief JSON document stored on a tape of 64 bit words
+ *
+ * Each value is a word with the type in the upper 8 bits and a 56 bit payload,
+ * numbers take one more word for the value. Containers store the position of their
+ * matching end, so a value is skipped without visiting its children. The children of an
+ * object are its keys, each key is followed by its value. Strings are stored in a side
+ * buffer as a 64 bit length followed by the zero terminated characters.
+ *
+ * Values are addressed by their tape position. The root is at position 0,
+ * it is never a child, so position 0 also means no value in the navigation functions.
+ */
+typedef struct
+{
+	uint64_t *words;		 ///<\brief the tape words
+	size_t size;			 ///<\brief the number of tape words
+	size_t capacity;		 ///<\brief the number of allocated tape words
+	char *strings;			 ///<\brief the string buffer
+	size_t strings_size;	 ///<\brief the number of used string buffer bytes
+	size_t strings_capacity; ///<\brief the number of allocated string buffer bytes
+	size_t max_depth;		 ///<\brief the maximal number of nested containers
+} json_tape;
+
+/**
+ * @brief Initialize an empty tape
+ *
+ * @param tape The tape
+ */
+void json_tape_init(json_tape *tape);
+
+/**
+ * @brief Set the maximal nesting depth accepted when building a tape
+ *
+ * @param tape The tape
+ * @param max_depth The maximal number of nested containers, JSON_TAPE_MAX_DEPTH by default
+ * @return 0 on success, -1 if max_depth is 0
+ */
+int json_tape_set_max_depth(json_tape *tape, size_t max_depth);
+
+/**
+ * @brief Build a tape from a token tape
+ *
+ * The tokens are validated against the grammar of the parser, the root is an array or an object.
+ * Input nested deeper than the maximal depth of the tape is rejected.
+ * The storage of the tape is reused, the token tape can be deleted after building.
+ *
+ * @param tape The tape
+ * @param tokens The token tape
+ * @param[out] end Position of the first token after the root
+ * @return 0 on success, -1 if the tokens could not be interpreted
+ */
+int json_tape_build(json_tape *tape, token_tape const *tokens, size_t *end);
+
+/**
+ * @brief Lex a character buffer and build a tape from it
+ *
+ * @param tape The tape
+ * @param buf The input buffer
+ * @param len The number of characters in the buffer
+ * @return 0 on success, -1 if could not read, interpret or the buffer has trailing tokens
+ */
+int json_tape_build_from_buffer(json_tape *tape, char const *buf, size_t len);
+
+/**
+ * @brief Release the storage of a tape
+ *
+ * @param tape The tape
+ */
+void json_tape_free(json_tape *tape);
+
+/**
+ * @brief Get the type of a value
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @return The type of the value
+ */
+json_tape_type_t json_tape_type(json_tape const *tape, size_t pos);
+
+/**
+ * @brief Get the first child of a container
+ *
+ * @param tape The tape
+ * @param pos The position of the container
+ * @return The position of the first child, or 0 if the container is empty or the value is not a container
+ */
+size_t json_tape_first_child(json_tape const *tape, size_t pos);
+
+/**
+ * @brief Get the next sibling of a value
+ *
+ * The siblings of an object key are the other keys of the object.
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @return The position of the next sibling, or 0 if the value is the last child
+ */
+size_t json_tape_next_sibling(json_tape const *tape, size_t pos);
+
+/**
+ * @brief Get the value of an object key
+ *
+ * @param tape The tape
+ * @param pos The position of the key
+ * @return The position of the value
+ */
+size_t json_tape_key_value(json_tape const *tape, size_t pos);
+
+/**
+ * @brief Get a specific field of an object
+ *
+ * @param tape The tape
+ * @param pos The position of the object
+ * @param fieldname The searched field name
+ * @return The position of the value or 0 if the field does not exist
+ */
+size_t json_tape_get_field(json_tape const *tape, size_t pos, char const *fieldname);
+
+/**
+ * @brief Get the body of a string or a key
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @param[out] value The zero terminated string body
+ * @return 0 on success, -1 if the value is not a string or a key
+ */
+int json_tape_get_string(json_tape const *tape, size_t pos, json_string *value);
+
+/**
+ * @brief Get the value of a number as a double
+ *
+ * Integers are converted to the nearest double.
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the value is not a number
+ */
+int json_tape_get_double(json_tape const *tape, size_t pos, double *value);
+
+/**
+ * @brief Get the value of a number as a signed 64 bit integer
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the value is not a number or not an integer in the range of int64_t
+ */
+int json_tape_get_int64(json_tape const *tape, size_t pos, int64_t *value);
+
+/**
+ * @brief Get the value of a number as an unsigned 64 bit integer
+ *
+ * @param tape The tape
+ * @param pos The position of the value
+ * @param[out] value The number value
+ * @return 0 on success, -1 if the value is not a number or not an integer in the range of uint64_t
+ */
+int json_tape_get_uint64(json_tape const *tape, size_t pos, uint64_t *value);
+
+/**
+ * @brief Print a tape in the format of the syntax tree printer
+ *
+ * @param tape The tape
+ * @param fout Output stream
+ */
+void json_tape_print(json_tape const *tape, FILE *fout);
+
+#endif // TAPE_JSON_H_INCLUDED
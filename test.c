@@ -17,14 +17,12 @@ int main(int argc, char *argv[])
 	}
 
 	char *fname = argv[1];
-	FILE *fin = fopen(fname, "r");
-	if (fin == NULL)
+	token_list tl = token_list_read_from_mmap(fname);
+	if (tl == NULL)
 	{
-		fprintf(stderr, "Could not open file %s\n", fname);
+		fprintf(stderr, "Could not read tokens from file %s\n", fname);
 		return 1;
 	}
-	token_list tl = token_list_read_from_file(fin);
-	fclose(fin);
 
 	token_list_print(tl, stdout);
 